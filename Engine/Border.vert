@@ -2,13 +2,13 @@
 layout (location = 0) in vec3 aPos;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+#include "FrameData.glsl"
 
 void main()
 {
     //gl_Position = projection * view * model * vec4(aPos, 1.0);
 
-    vec4 pos = projection * view * model * vec4(aPos, 1.0);
+    vec4 pos = viewProj * model * vec4(aPos, 1.0);
     gl_Position = pos.xyww;
 }
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <glm/glm/glm.hpp>
+
+// axis aligned bounding box
+struct Bounds
+{
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 max = glm::vec3(0.0f);
+
+    Bounds() = default;
+    Bounds(const glm::vec3& min, const glm::vec3& max) : min(min), max(max) {}
+
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+    // half the size along each axis
+    glm::vec3 extent() const { return (max - min) * 0.5f; }
+    // radius of the sphere around the box
+    float radius() const { return glm::length(extent()); }
+
+    void merge(const Bounds& other)
+    {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    // the box around this one after the transform (Arvo)
+    Bounds transformed(const glm::mat4& m) const
+    {
+        glm::vec3 newCenter = glm::vec3(m * glm::vec4(center(), 1.0f));
+        glm::vec3 oldExtent = extent();
+        glm::vec3 newExtent(0.0f);
+        for (int column = 0; column < 3; column++)
+            newExtent += glm::abs(glm::vec3(m[column])) * oldExtent[column];
+        return Bounds(newCenter - newExtent, newCenter + newExtent);
+    }
+};
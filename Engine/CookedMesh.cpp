@@ -0,0 +1,107 @@
+#include "CookedMesh.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+    // every distinct position once, and the indices rewritten to point at them. The triangle order is kept
+    void buildPositionStream(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+        std::vector<glm::vec3>& positions, std::vector<unsigned int>& positionIndices)
+    {
+        std::vector<unsigned int> order(vertices.size());
+        for (unsigned int i = 0; i < order.size(); i++)
+            order[i] = i;
+        auto less = [](const glm::vec3& a, const glm::vec3& b)
+        {
+            if (a.x != b.x) return a.x < b.x;
+            if (a.y != b.y) return a.y < b.y;
+            return a.z < b.z;
+        };
+        std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return less(vertices[a].Position, vertices[b].Position); });
+
+        std::vector<unsigned int> remap(vertices.size());
+        for (unsigned int i = 0; i < order.size(); i++)
+        {
+            const glm::vec3& position = vertices[order[i]].Position;
+            if (positions.empty() || less(positions.back(), position))
+                positions.push_back(position);
+            remap[order[i]] = static_cast<unsigned int>(positions.size() - 1);
+        }
+        positionIndices.resize(indices.size());
+        for (size_t i = 0; i < indices.size(); i++)
+            positionIndices[i] = remap[indices[i]];
+    }
+
+    // appends the indices as indexType
+    void appendIndices(std::vector<unsigned char>& storage, const std::vector<unsigned int>& indices, GLenum indexType)
+    {
+        size_t offset = storage.size();
+        if (indexType == GL_UNSIGNED_SHORT)
+        {
+            storage.resize(offset + indices.size() * sizeof(uint16_t));
+            for (size_t i = 0; i < indices.size(); i++)
+            {
+                uint16_t index = static_cast<uint16_t>(indices[i]);
+                std::memcpy(storage.data() + offset + i * sizeof(uint16_t), &index, sizeof(index));
+            }
+        }
+        else
+        {
+            storage.resize(offset + indices.size() * sizeof(unsigned int));
+            if (!indices.empty())
+                std::memcpy(storage.data() + offset, indices.data(), indices.size() * sizeof(unsigned int));
+        }
+    }
+}
+
+CookedMesh CookedMesh::cook(std::vector<Vertex> vertices, std::vector<unsigned int> indices, VertexFormat format, std::vector<MeshLod> lods)
+{
+    CookedMesh cooked;
+    cooked.format = format;
+    cooked.vertexCount = vertices.size();
+    cooked.lods = std::move(lods);
+    if (cooked.lods.empty())
+        cooked.lods.push_back({ 0, static_cast<unsigned int>(indices.size()), 0.0f });
+    if (!vertices.empty())
+    {
+        cooked.bounds = Bounds(vertices[0].Position, vertices[0].Position);
+        for (const Vertex& vertex : vertices)
+            cooked.bounds.merge(Bounds(vertex.Position, vertex.Position));
+    }
+    cooked.meshlets = Meshlets::build(vertices, indices, cooked.lods[0].indexCount);
+
+    // indices are narrowed to 16 bits if they fit, halving the buffer and the index fetch
+    cooked.indexType = vertices.size() <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+    // skinned meshes would need the bones to place their positions
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> positionIndices;
+    if (!format.skinned && !vertices.empty())
+        buildPositionStream(vertices, indices, positions, positionIndices);
+    cooked.positionCount = positions.size();
+
+    // the blobs back to back, pointed at once the storage has its final size
+    std::vector<unsigned char> packed = format.pack(vertices);
+    std::vector<unsigned char>& storage = cooked.storage;
+    storage.insert(storage.end(), packed.begin(), packed.end());
+    size_t indicesOffset = storage.size();
+    appendIndices(storage, indices, cooked.indexType);
+    size_t positionsOffset = storage.size();
+    storage.resize(positionsOffset + positions.size() * sizeof(glm::vec3));
+    if (!positions.empty())
+        std::memcpy(storage.data() + positionsOffset, positions.data(), positions.size() * sizeof(glm::vec3));
+    size_t positionIndicesOffset = storage.size();
+    if (!positions.empty())
+        appendIndices(storage, positionIndices, cooked.indexType);
+
+    cooked.vertices = { storage.data(), indicesOffset };
+    cooked.indices = { storage.data() + indicesOffset, positionsOffset - indicesOffset };
+    cooked.positions = { storage.data() + positionsOffset, positionIndicesOffset - positionsOffset };
+    cooked.positionIndices = { storage.data() + positionIndicesOffset, storage.size() - positionIndicesOffset };
+
+    cooked.sourceVertices = std::move(vertices);
+    cooked.sourceIndices = std::move(indices);
+    return cooked;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Bounds.h"
+#include "MeshLod.h"
+#include "Meshlet.h"
+#include "VertexFormat.h"
+
+struct Texture {
+    unsigned int id;
+    std::string type;
+    std::string path;
+};
+
+// bytes ready for glBufferData, in CookedMesh::storage or in a mapped cache file
+struct Blob
+{
+    const void* data = nullptr;
+    size_t size = 0;
+};
+
+// A mesh processed for the GPU: vertices packed in their format, indices narrowed to indexType, the position
+// stream and everything derived from the geometry. Mesh uploads it as it is, MeshCache writes it to disk
+struct CookedMesh
+{
+    VertexFormat format;
+    GLenum indexType = GL_UNSIGNED_INT;
+    size_t vertexCount = 0;
+    // 0 when there is no position stream (skinned meshes)
+    size_t positionCount = 0;
+    std::vector<MeshLod> lods;
+    std::vector<Meshlet> meshlets;
+    Bounds bounds;
+    // only type and path, the ids are filled in when the textures are loaded
+    std::vector<Texture> textures;
+
+    Blob vertices;
+    // every level of detail
+    Blob indices;
+    Blob positions;
+    // same count and order as indices
+    Blob positionIndices;
+    // backing memory of the blobs when they don't point into a mapped file. Moving keeps them valid
+    std::vector<unsigned char> storage;
+
+    // what it was cooked from, for meshes that keep their CPU copy. Empty when loaded from the cache
+    std::vector<Vertex> sourceVertices;
+    std::vector<unsigned int> sourceIndices;
+
+    CookedMesh() = default;
+    CookedMesh(CookedMesh&&) = default;
+    CookedMesh& operator=(CookedMesh&&) = default;
+    // a copy would point into the storage of the original
+    CookedMesh(const CookedMesh&) = delete;
+    CookedMesh& operator=(const CookedMesh&) = delete;
+
+    size_t indexSize() const { return indexType == GL_UNSIGNED_SHORT ? 2 : 4; }
+    size_t indexCount() const { return indices.size / indexSize(); }
+
+    // cooks the vertices and the indices of all levels of detail. Without lods the indices are one level
+    static CookedMesh cook(std::vector<Vertex> vertices, std::vector<unsigned int> indices, VertexFormat format, std::vector<MeshLod> lods);
+};
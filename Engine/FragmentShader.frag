@@ -32,11 +32,20 @@ in vec3 FragPos;
 in vec2 TexCoords;
   
 uniform vec3 objectColor;
-uniform vec3 viewPos;
 uniform Material material;
-uniform DirLight dirLight;
-#define NR_POINT_LIGHTS 4  
-uniform PointLight pointLights[NR_POINT_LIGHTS];
+
+#include "FrameData.glsl"
+
+// the application injects the light count, so the loop below is unrolled for the exact number
+#ifndef NR_POINT_LIGHTS
+#define NR_POINT_LIGHTS 4
+#endif
+// uploaded once as a whole, mirrored by ShaderUniforms::Lights
+layout (std140) uniform Lights
+{
+    DirLight dirLight;
+    PointLight pointLights[NR_POINT_LIGHTS];
+};
 
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
@@ -49,7 +58,7 @@ void main()
 {
     // properties
     vec3 norm = normalize(Normal);
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 viewDir = normalize(cameraPos.xyz - FragPos);
 
     // phase 1: Directional lighting
     vec3 result = CalcDirLight(dirLight, norm, viewDir);
@@ -73,13 +82,20 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
     vec3 lightDir = normalize(-light.direction);
     // diffuse shading
     float diff = max(dot(normal, lightDir), 0.0);
+#ifndef NO_SPECULAR_MAP
     // specular shading
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+#endif
     // combine results
     vec3 ambient  = light.ambient  * vec3(texture(material.diffuse, TexCoords));
     vec3 diffuse  = light.diffuse  * diff * vec3(texture(material.diffuse, TexCoords));
+#ifdef NO_SPECULAR_MAP
+    // permutation for meshes without a specular map, skips the highlight entirely
+    vec3 specular = vec3(0.0);
+#else
     vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
+#endif
     return (ambient + diffuse + specular);
 }
 
@@ -88,9 +104,11 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     vec3 lightDir = normalize(light.position - fragPos);
     // diffuse shading
     float diff = max(dot(normal, lightDir), 0.0);
+#ifndef NO_SPECULAR_MAP
     // specular shading
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+#endif
     // attenuation
     float distance    = length(light.position - fragPos);
     float attenuation = 1.0 / (light.constant + light.linear * distance + 
@@ -98,7 +116,11 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     // combine results
     vec3 ambient  = light.ambient  * vec3(texture(material.diffuse, TexCoords));
     vec3 diffuse  = light.diffuse  * diff * vec3(texture(material.diffuse, TexCoords));
+#ifdef NO_SPECULAR_MAP
+    vec3 specular = vec3(0.0);
+#else
     vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
+#endif
     ambient  *= attenuation;
     diffuse  *= attenuation;
     specular *= attenuation;
@@ -0,0 +1,9 @@
+// camera state of the current frame, written once per frame by FrameUniforms (FrameData.h)
+layout (std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProj;
+    vec4 cameraPos;
+    float time;
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm/glm.hpp>
+
+#include "ShaderUniforms.h"
+#include "UniformBuffer.h"
+
+// CPU side mirror of the std140 FrameData block declared in FrameData.glsl, generated by ShaderReflect
+typedef ShaderUniforms::FrameData FrameData;
+
+// Uniform buffer holding the camera state of the current frame. Written once per frame and shared by every program,
+// so the matrices are not uploaded again for every shader and every draw
+class FrameUniforms
+{
+public:
+    // uploads the camera state, call once per frame before the first draw
+    void update(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos, float time)
+    {
+        FrameData data;
+        data.view = view;
+        data.projection = projection;
+        data.viewProj = projection * view;
+        data.cameraPos = glm::vec4(cameraPos, 1.0f);
+        data.time = time;
+        buffer.update(data);
+    }
+
+private:
+    UniformBuffer<FrameData> buffer;
+};
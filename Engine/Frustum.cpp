@@ -0,0 +1,60 @@
+#include "Frustum.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_SSE 1
+#include <xmmintrin.h>
+#endif
+
+void Frustum::cullSpheres(const glm::vec4* spheres, size_t count, unsigned char* visible) const
+{
+    // normalized planes, so the distance can be compared with the radius directly
+    glm::vec4 normalized[6];
+    for (int p = 0; p < 6; p++)
+        normalized[p] = planes[p] / glm::length(glm::vec3(planes[p]));
+
+    size_t i = 0;
+#ifdef FRUSTUM_SSE
+    __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+    for (int p = 0; p < 6; p++)
+    {
+        planeX[p] = _mm_set1_ps(normalized[p].x);
+        planeY[p] = _mm_set1_ps(normalized[p].y);
+        planeZ[p] = _mm_set1_ps(normalized[p].z);
+        planeW[p] = _mm_set1_ps(normalized[p].w);
+    }
+    for (; i + 4 <= count; i += 4)
+    {
+        // four spheres turned into one register per component
+        __m128 x = _mm_loadu_ps(&spheres[i].x);
+        __m128 y = _mm_loadu_ps(&spheres[i + 1].x);
+        __m128 z = _mm_loadu_ps(&spheres[i + 2].x);
+        __m128 radius = _mm_loadu_ps(&spheres[i + 3].x);
+        _MM_TRANSPOSE4_PS(x, y, z, radius);
+        __m128 zero = _mm_setzero_ps();
+        __m128 negativeRadius = _mm_sub_ps(zero, radius);
+
+        // all bits set, cleared per lane by the first plane the sphere is outside of
+        __m128 inside = _mm_cmpeq_ps(zero, zero);
+        for (int p = 0; p < 6; p++)
+        {
+            __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(x, planeX[p]), _mm_mul_ps(y, planeY[p])),
+                _mm_add_ps(_mm_mul_ps(z, planeZ[p]), planeW[p]));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+        }
+        int mask = _mm_movemask_ps(inside);
+        visible[i] = mask & 1;
+        visible[i + 1] = (mask >> 1) & 1;
+        visible[i + 2] = (mask >> 2) & 1;
+        visible[i + 3] = (mask >> 3) & 1;
+    }
+#endif
+    for (; i < count; i++)
+    {
+        glm::vec3 center(spheres[i]);
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; p++)
+            inside = glm::dot(glm::vec3(normalized[p]), center) + normalized[p].w >= -spheres[i].w;
+        visible[i] = inside ? 1 : 0;
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <glm/glm/glm.hpp>
+
+#include <cstddef>
+
+#include "Bounds.h"
+
+// objects and instances tested against the view frustum, reset once per frame
+struct CullingStats
+{
+    unsigned int visible = 0;
+    unsigned int culled = 0;
+};
+inline CullingStats cullingStats;
+
+// The six planes of a clip space volume, extracted from the matrix that maps into it (Gribb/Hartmann).
+// Built from projection * view * model the planes are in the object space of that model,
+// so bounds can be tested without transforming them
+struct Frustum
+{
+    // ax + by + cz + d >= 0 inside, not normalized
+    glm::vec4 planes[6];
+
+    static Frustum fromMatrix(const glm::mat4& m)
+    {
+        glm::vec4 rowX(m[0][0], m[1][0], m[2][0], m[3][0]);
+        glm::vec4 rowY(m[0][1], m[1][1], m[2][1], m[3][1]);
+        glm::vec4 rowZ(m[0][2], m[1][2], m[2][2], m[3][2]);
+        glm::vec4 rowW(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+        Frustum frustum;
+        frustum.planes[0] = rowW + rowX; // left
+        frustum.planes[1] = rowW - rowX; // right
+        frustum.planes[2] = rowW + rowY; // bottom
+        frustum.planes[3] = rowW - rowY; // top
+        frustum.planes[4] = rowW + rowZ; // near
+        frustum.planes[5] = rowW - rowZ; // far
+        return frustum;
+    }
+
+    // false if the sphere is entirely outside one of the planes
+    bool intersectsSphere(const glm::vec3& center, float radius) const
+    {
+        for (const glm::vec4& plane : planes)
+        {
+            glm::vec3 normal(plane);
+            if (glm::dot(normal, center) + plane.w < -radius * glm::length(normal))
+                return false;
+        }
+        return true;
+    }
+
+    // false if the box is entirely outside one of the planes
+    bool intersectsBox(const Bounds& bounds) const
+    {
+        glm::vec3 center = bounds.center();
+        glm::vec3 extent = bounds.extent();
+        for (const glm::vec4& plane : planes)
+        {
+            glm::vec3 normal(plane);
+            if (glm::dot(normal, center) + plane.w < -glm::dot(glm::abs(normal), extent))
+                return false;
+        }
+        return true;
+    }
+
+    // tests count spheres (xyz center, w radius) at once, four per step with SSE.
+    // visible[i] is set to 1 if sphere i intersects the frustum and 0 otherwise
+    void cullSpheres(const glm::vec4* spheres, size_t count, unsigned char* visible) const;
+};
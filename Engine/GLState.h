@@ -0,0 +1,160 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <array>
+
+// Mirror of the GL state the frame keeps switching (program, vertex array, texture bindings, depth and stencil).
+// Calls that would set what is already current are dropped before they reach the driver.
+// Draw code has to go through here, otherwise the mirror goes stale. Setup code may talk to GL directly
+// as long as invalidate() is called before drawing again
+namespace GLState
+{
+    // counters of the current frame, reset once per frame
+    struct Stats
+    {
+        unsigned int issued = 0;
+        unsigned int skipped = 0;
+    };
+    inline Stats stats;
+
+    const unsigned int TRACKED_TEXTURE_UNITS = 16;
+
+    // a piece of state and whether it is known at all
+    template <typename T>
+    struct Tracked
+    {
+        T value{};
+        bool known = false;
+
+        // records the value, false if it is current already and the call can be skipped
+        bool update(const T& newValue)
+        {
+            if (known && value == newValue)
+            {
+                stats.skipped++;
+                return false;
+            }
+            value = newValue;
+            known = true;
+            stats.issued++;
+            return true;
+        }
+    };
+
+    struct Cache
+    {
+        Tracked<unsigned int> program;
+        Tracked<unsigned int> vertexArray;
+        Tracked<GLenum> activeUnit;
+        Tracked<unsigned int> textures2D[TRACKED_TEXTURE_UNITS];
+        Tracked<unsigned int> texturesCube[TRACKED_TEXTURE_UNITS];
+        Tracked<bool> depthTest, stencilTest, blend, cullFace;
+        Tracked<GLenum> depthFunc;
+        Tracked<std::array<GLuint, 3>> stencilFunc;
+        Tracked<std::array<GLenum, 3>> stencilOp;
+        Tracked<GLuint> stencilMask;
+    };
+    inline Cache cache;
+
+    // forgets everything, the next call of each kind is always issued
+    inline void invalidate()
+    {
+        cache = Cache();
+    }
+
+    inline void useProgram(unsigned int program)
+    {
+        if (cache.program.update(program))
+            glUseProgram(program);
+    }
+
+    inline void bindVertexArray(unsigned int vertexArray)
+    {
+        if (cache.vertexArray.update(vertexArray))
+            glBindVertexArray(vertexArray);
+    }
+
+    inline void activeTexture(GLenum unit)
+    {
+        if (cache.activeUnit.update(unit))
+            glActiveTexture(unit);
+    }
+
+    // binds to the active unit, GL_TEXTURE_2D and GL_TEXTURE_CUBE_MAP on the first units are tracked
+    inline void bindTexture(GLenum target, unsigned int texture)
+    {
+        unsigned int unit = cache.activeUnit.known ? cache.activeUnit.value - GL_TEXTURE0 : TRACKED_TEXTURE_UNITS;
+        Tracked<unsigned int>* binding = nullptr;
+        if (unit < TRACKED_TEXTURE_UNITS && target == GL_TEXTURE_2D)
+            binding = &cache.textures2D[unit];
+        else if (unit < TRACKED_TEXTURE_UNITS && target == GL_TEXTURE_CUBE_MAP)
+            binding = &cache.texturesCube[unit];
+
+        if (!binding)
+            stats.issued++;
+        if (!binding || binding->update(texture))
+            glBindTexture(target, texture);
+    }
+
+    // binds texture to unit GL_TEXTURE0 + unit
+    inline void bindTextureUnit(unsigned int unit, GLenum target, unsigned int texture)
+    {
+        activeTexture(GL_TEXTURE0 + unit);
+        bindTexture(target, texture);
+    }
+
+    inline Tracked<bool>* capability(GLenum cap)
+    {
+        switch (cap)
+        {
+        case GL_DEPTH_TEST: return &cache.depthTest;
+        case GL_STENCIL_TEST: return &cache.stencilTest;
+        case GL_BLEND: return &cache.blend;
+        case GL_CULL_FACE: return &cache.cullFace;
+        default: return nullptr;
+        }
+    }
+
+    inline void enable(GLenum cap)
+    {
+        Tracked<bool>* state = capability(cap);
+        if (!state)
+            stats.issued++;
+        if (!state || state->update(true))
+            glEnable(cap);
+    }
+
+    inline void disable(GLenum cap)
+    {
+        Tracked<bool>* state = capability(cap);
+        if (!state)
+            stats.issued++;
+        if (!state || state->update(false))
+            glDisable(cap);
+    }
+
+    inline void depthFunc(GLenum func)
+    {
+        if (cache.depthFunc.update(func))
+            glDepthFunc(func);
+    }
+
+    inline void stencilFunc(GLenum func, GLint ref, GLuint mask)
+    {
+        if (cache.stencilFunc.update({ func, static_cast<GLuint>(ref), mask }))
+            glStencilFunc(func, ref, mask);
+    }
+
+    inline void stencilOp(GLenum sfail, GLenum dpfail, GLenum dppass)
+    {
+        if (cache.stencilOp.update({ sfail, dpfail, dppass }))
+            glStencilOp(sfail, dpfail, dppass);
+    }
+
+    inline void stencilMask(GLuint mask)
+    {
+        if (cache.stencilMask.update(mask))
+            glStencilMask(mask);
+    }
+}
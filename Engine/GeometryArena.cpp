@@ -0,0 +1,290 @@
+#include "GeometryArena.h"
+#include "GLState.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace
+{
+    // capacity of a new pool, doubled whenever it runs out
+    const size_t INITIAL_VERTICES = 1 << 16;
+    const size_t INITIAL_INDICES = 1 << 18;
+
+    // copies count bytes between buffers without a round trip through the CPU
+    void copyBuffer(unsigned int from, size_t fromOffset, unsigned int to, size_t toOffset, size_t count)
+    {
+        if (count == 0)
+            return;
+        glBindBuffer(GL_COPY_READ_BUFFER, from);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, to);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, fromOffset, toOffset, count);
+    }
+
+    unsigned int createBuffer(size_t size)
+    {
+        unsigned int buffer;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STATIC_DRAW);
+        return buffer;
+    }
+
+    void upload(unsigned int buffer, size_t offset, size_t size, const void* data)
+    {
+        if (size == 0)
+            return;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+    }
+}
+
+GeometryArena& GeometryArena::global()
+{
+    static GeometryArena arena;
+    return arena;
+}
+
+GeometryArena::~GeometryArena()
+{
+    release();
+}
+
+void GeometryArena::release()
+{
+    for (Pool& pool : pools)
+    {
+        deleteBuffers(pool);
+        glDeleteVertexArrays(1, &pool.VAO);
+    }
+    pools.clear();
+    allocations.clear();
+    freeHandles.clear();
+}
+
+unsigned int GeometryArena::allocate(const VertexFormat& format, GLenum indexType, const void* vertexData, size_t vertexCount, const void* indexData, size_t indexCount)
+{
+    unsigned int poolIndex = poolFor(format, indexType);
+    Pool& pool = pools[poolIndex];
+
+    Range range;
+    range.pool = poolIndex;
+    range.vertexCount = vertexCount;
+    range.indexCount = indexCount;
+    range.live = true;
+
+    // the free range at the end of the pool merges with what growing adds, so the old capacity
+    // plus the request is always enough. Both buffers grow in one go, a new pool would otherwise copy twice
+    bool vertexFits = vertexCount == 0 || pool.freeVertices.allocate(vertexCount, range.firstVertex);
+    bool indexFits = indexCount == 0 || pool.freeIndices.allocate(indexCount, range.firstIndex);
+    if (!vertexFits || !indexFits)
+    {
+        size_t vertexCapacity = pool.vertexCapacity;
+        if (!vertexFits)
+        {
+            vertexCapacity = std::max(pool.vertexCapacity, INITIAL_VERTICES);
+            while (vertexCapacity < pool.vertexCapacity + vertexCount)
+                vertexCapacity *= 2;
+        }
+        size_t indexCapacity = pool.indexCapacity;
+        if (!indexFits)
+        {
+            indexCapacity = std::max(pool.indexCapacity, INITIAL_INDICES);
+            while (indexCapacity < pool.indexCapacity + indexCount)
+                indexCapacity *= 2;
+        }
+        grow(pool, vertexCapacity, indexCapacity);
+        if (!vertexFits)
+            pool.freeVertices.allocate(vertexCount, range.firstVertex);
+        if (!indexFits)
+            pool.freeIndices.allocate(indexCount, range.firstIndex);
+    }
+
+    size_t stride = pool.format.stride();
+    upload(pool.VBO, range.firstVertex * stride, vertexCount * stride, vertexData);
+    upload(pool.EBO, range.firstIndex * pool.indexSize(), indexCount * pool.indexSize(), indexData);
+
+    unsigned int allocation;
+    if (!freeHandles.empty())
+    {
+        allocation = freeHandles.back();
+        freeHandles.pop_back();
+        allocations[allocation] = range;
+    }
+    else
+    {
+        allocation = static_cast<unsigned int>(allocations.size());
+        allocations.push_back(range);
+    }
+    return allocation;
+}
+
+void GeometryArena::free(unsigned int allocation)
+{
+    if (allocation >= allocations.size() || !allocations[allocation].live)
+        return;
+
+    Range& range = allocations[allocation];
+    Pool& pool = pools[range.pool];
+    if (range.vertexCount > 0)
+        pool.freeVertices.release(range.firstVertex, range.vertexCount);
+    if (range.indexCount > 0)
+        pool.freeIndices.release(range.firstIndex, range.indexCount);
+    range = Range();
+    freeHandles.push_back(allocation);
+}
+
+void GeometryArena::compact()
+{
+    for (unsigned int p = 0; p < pools.size(); p++)
+    {
+        Pool& pool = pools[p];
+        size_t stride = pool.format.stride();
+
+        size_t usedVertices = 0, usedIndices = 0;
+        for (const Range& range : allocations)
+        {
+            if (range.live && range.pool == p)
+            {
+                usedVertices += range.vertexCount;
+                usedIndices += range.indexCount;
+            }
+        }
+        if (usedVertices == pool.vertexCapacity && usedIndices == pool.indexCapacity)
+            continue;
+
+        // copy every live range to the front of new buffers of exactly the used size
+        unsigned int VBO = createBuffer(usedVertices * stride);
+        unsigned int EBO = createBuffer(usedIndices * pool.indexSize());
+        size_t vertexEnd = 0, indexEnd = 0;
+        for (Range& range : allocations)
+        {
+            if (!range.live || range.pool != p)
+                continue;
+            copyBuffer(pool.VBO, range.firstVertex * stride, VBO, vertexEnd * stride, range.vertexCount * stride);
+            copyBuffer(pool.EBO, range.firstIndex * pool.indexSize(), EBO, indexEnd * pool.indexSize(), range.indexCount * pool.indexSize());
+            range.firstVertex = vertexEnd;
+            range.firstIndex = indexEnd;
+            vertexEnd += range.vertexCount;
+            indexEnd += range.indexCount;
+        }
+
+        deleteBuffers(pool);
+        pool.VBO = VBO;
+        pool.EBO = EBO;
+        pool.vertexCapacity = usedVertices;
+        pool.indexCapacity = usedIndices;
+        pool.freeVertices.ranges.clear();
+        pool.freeIndices.ranges.clear();
+        attach(pool);
+    }
+}
+
+size_t GeometryArena::usedBytes() const
+{
+    size_t bytes = 0;
+    for (const Range& range : allocations)
+    {
+        if (range.live)
+            bytes += range.vertexCount * pools[range.pool].format.stride() + range.indexCount * pools[range.pool].indexSize();
+    }
+    return bytes;
+}
+
+size_t GeometryArena::capacityBytes() const
+{
+    size_t bytes = 0;
+    for (const Pool& pool : pools)
+        bytes += pool.vertexCapacity * pool.format.stride() + pool.indexCapacity * pool.indexSize();
+    return bytes;
+}
+
+bool GeometryArena::FreeList::allocate(size_t count, size_t& offset)
+{
+    for (auto it = ranges.begin(); it != ranges.end(); ++it)
+    {
+        if (it->second < count)
+            continue;
+        offset = it->first;
+        size_t rest = it->second - count;
+        ranges.erase(it);
+        if (rest > 0)
+            ranges[offset + count] = rest;
+        return true;
+    }
+    return false;
+}
+
+void GeometryArena::FreeList::release(size_t offset, size_t count)
+{
+    auto next = ranges.lower_bound(offset);
+    if (next != ranges.end() && offset + count == next->first)
+    {
+        count += next->second;
+        next = ranges.erase(next);
+    }
+    if (next != ranges.begin())
+    {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset)
+        {
+            previous->second += count;
+            return;
+        }
+    }
+    ranges[offset] = count;
+}
+
+unsigned int GeometryArena::poolFor(const VertexFormat& format, GLenum indexType)
+{
+    for (unsigned int p = 0; p < pools.size(); p++)
+    {
+        if (pools[p].format == format && pools[p].indexType == indexType)
+            return p;
+    }
+
+    Pool pool;
+    pool.format = format;
+    pool.indexType = indexType;
+    pools.push_back(pool);
+    return static_cast<unsigned int>(pools.size() - 1);
+}
+
+void GeometryArena::grow(Pool& pool, size_t vertexCapacity, size_t indexCapacity)
+{
+    size_t stride = pool.format.stride();
+    unsigned int VBO = createBuffer(vertexCapacity * stride);
+    unsigned int EBO = createBuffer(indexCapacity * pool.indexSize());
+    copyBuffer(pool.VBO, 0, VBO, 0, pool.vertexCapacity * stride);
+    copyBuffer(pool.EBO, 0, EBO, 0, pool.indexCapacity * pool.indexSize());
+
+    if (vertexCapacity > pool.vertexCapacity)
+        pool.freeVertices.release(pool.vertexCapacity, vertexCapacity - pool.vertexCapacity);
+    if (indexCapacity > pool.indexCapacity)
+        pool.freeIndices.release(pool.indexCapacity, indexCapacity - pool.indexCapacity);
+
+    deleteBuffers(pool);
+    pool.VBO = VBO;
+    pool.EBO = EBO;
+    pool.vertexCapacity = vertexCapacity;
+    pool.indexCapacity = indexCapacity;
+    attach(pool);
+}
+
+void GeometryArena::attach(Pool& pool)
+{
+    if (!pool.VAO)
+        glGenVertexArrays(1, &pool.VAO);
+    GLState::bindVertexArray(pool.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, pool.VBO);
+    pool.format.setAttributes();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.EBO);
+}
+
+void GeometryArena::deleteBuffers(Pool& pool)
+{
+    if (pool.VBO)
+        glDeleteBuffers(1, &pool.VBO);
+    if (pool.EBO)
+        glDeleteBuffers(1, &pool.EBO);
+    pool.VBO = pool.EBO = 0;
+}
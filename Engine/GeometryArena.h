@@ -0,0 +1,94 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+#include "VertexFormat.h"
+
+// Large vertex and index buffers shared by every mesh with the same vertex format and index type.
+// Each such pool has one VAO, meshes get a range of it and are drawn with glDrawElementsBaseVertex,
+// so switching between them needs no rebinding at all.
+// Pools grow by reallocating and copying on the GPU. The pool VAO stays the same but its attribute
+// pointers are set again, attributes added to it from outside have to be set after the geometry is in
+class GeometryArena
+{
+public:
+    static const unsigned int INVALID = ~0u;
+
+    // where a mesh lives in its pool, in vertices and indices
+    struct Range
+    {
+        unsigned int pool = 0;
+        size_t firstVertex = 0;
+        size_t vertexCount = 0;
+        size_t firstIndex = 0;
+        size_t indexCount = 0;
+        bool live = false;
+    };
+
+    // the arena the models load into unless they are given another one
+    static GeometryArena& global();
+
+    GeometryArena() = default;
+    ~GeometryArena();
+    GeometryArena(const GeometryArena&) = delete;
+    GeometryArena& operator=(const GeometryArena&) = delete;
+
+    // copies packed vertices (VertexFormat::pack) and indices of type indexType into the pool of that format,
+    // returns the allocation handle
+    unsigned int allocate(const VertexFormat& format, GLenum indexType, const void* vertexData, size_t vertexCount, const void* indexData, size_t indexCount);
+    // gives the ranges of the allocation back to its pool
+    void free(unsigned int allocation);
+    // deletes every pool, allocations still held are gone with them. For shutdown, while the context is current
+    void release();
+    // moves the live ranges of every pool to the front and shrinks the buffers to fit, handles stay valid
+    void compact();
+
+    // current position of an allocation, changes with compact()
+    const Range& range(unsigned int allocation) const { return allocations[allocation]; }
+    // VAO of the pool an allocation lives in, with the pool buffers and the format attributes set
+    unsigned int vertexArray(unsigned int allocation) const { return pools[allocations[allocation].pool].VAO; }
+
+    // bytes in live ranges and bytes allocated on the GPU, over all pools
+    size_t usedBytes() const;
+    size_t capacityBytes() const;
+    size_t poolCount() const { return pools.size(); }
+
+private:
+    // free ranges, offset -> count, neighbours are always merged
+    struct FreeList
+    {
+        std::map<size_t, size_t> ranges;
+
+        // first fit, false if no range is large enough
+        bool allocate(size_t count, size_t& offset);
+        void release(size_t offset, size_t count);
+    };
+
+    struct Pool
+    {
+        VertexFormat format;
+        GLenum indexType = GL_UNSIGNED_INT;
+        unsigned int VAO = 0, VBO = 0, EBO = 0;
+        // capacities in vertices and indices
+        size_t vertexCapacity = 0, indexCapacity = 0;
+        FreeList freeVertices, freeIndices;
+
+        size_t indexSize() const { return indexType == GL_UNSIGNED_SHORT ? 2 : 4; }
+    };
+
+    std::vector<Pool> pools;
+    std::vector<Range> allocations;
+    // handles of freed allocations, reused first
+    std::vector<unsigned int> freeHandles;
+
+    unsigned int poolFor(const VertexFormat& format, GLenum indexType);
+    // reallocates the buffers of a pool with larger capacities and copies the contents over
+    void grow(Pool& pool, size_t vertexCapacity, size_t indexCapacity);
+    // points the pool VAO at the current buffers
+    void attach(Pool& pool);
+    void deleteBuffers(Pool& pool);
+};
@@ -5,11 +5,10 @@ layout (location = 3) in mat4 aInstanceMatrix;
 
 out vec2 TexCoords;
 
-uniform mat4 projection;
-uniform mat4 view;
+#include "FrameData.glsl"
 
 void main()
 {
     TexCoords = aTexCoords;
-    gl_Position = projection * view * aInstanceMatrix * vec4(aPos, 1.0f); 
+    gl_Position = viewProj * aInstanceMatrix * vec4(aPos, 1.0f); 
 }
\ No newline at end of file
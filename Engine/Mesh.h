@@ -2,67 +2,280 @@
 
 #include <glad/glad.h> // include glad to get all the required OpenGL headers
 #include <glm/glm/glm.hpp>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include "Shader.h"
+#include "GLState.h"
+#include "VertexFormat.h"
+#include "CookedMesh.h"
+#include "GeometryArena.h"
+#include "Meshlet.h"
+#include "MeshLod.h"
+#include "Bounds.h"
 
 using namespace std;
 
-#define MAX_BONE_INFLUENCE 4
-
-struct Vertex {
-    // position
-    glm::vec3 Position;
-    // normal
-    glm::vec3 Normal;
-    // texCoords
-    glm::vec2 TexCoords;
-    // tangent
-    glm::vec3 Tangent;
-    // bitangent
-    glm::vec3 Bitangent;
-    //bone indexes which will influence this vertex
-    int m_BoneIDs[MAX_BONE_INFLUENCE];
-    //weights from each bone
-    float m_Weights[MAX_BONE_INFLUENCE];
-};
-
-struct Texture {
-    unsigned int id;
-    string type;
-    string path;
+// what happens to the CPU copy of the geometry once it is uploaded
+enum class GeometryRetention
+{
+    // vertices and indices stay, for code that reads them back
+    Keep,
+    // vertices and indices are freed, only the counts and bounds remain
+    Release
 };
 
+// Owns its range of a GeometryArena, so it can be moved but not copied
 class Mesh {
 public:
-    // mesh Data
+    // meshlet culling of all meshes, reset once per frame
+    inline static MeshletStats meshletStats;
+
+    // mesh Data, empty after upload with GeometryRetention::Release. The indices of every level of detail follow each other
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
     vector<Texture>      textures;
-    unsigned int VAO;
+    // VAO of the arena pool the geometry is in, shared with every mesh of the same format
+    unsigned int VAO = 0;
+    // VAO of the position only copy, 0 for skinned meshes which draw the full layout instead
+    unsigned int positionVAO = 0;
+    // sizes of the uploaded geometry, valid whether or not the CPU copy is kept
+    size_t vertexCount = 0;
+    // distinct positions, vertices split only by their normal or uv share one in the position stream
+    size_t positionCount = 0;
+    // indices of the full detail level
+    size_t indexCount = 0;
+    // ranges of indices, the full mesh first and then ever coarser levels
+    vector<MeshLod> lods;
+    // object space bounding box of the vertices
+    Bounds bounds;
+    // slices of the index buffer that are culled on their own, kept after the geometry is released
+    vector<Meshlet> meshlets;
+    // layout of the vertex buffer
+    VertexFormat format;
+    // GL_UNSIGNED_SHORT when every vertex can be addressed with 16 bits, GL_UNSIGNED_INT otherwise
+    GLenum indexType = GL_UNSIGNED_INT;
+
+    // constructor, takes over the data passed in
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, VertexFormat format = VertexFormat(),
+        vector<MeshLod> lods = vector<MeshLod>(), GeometryRetention retention = GeometryRetention::Keep, GeometryArena& targetArena = GeometryArena::global())
+        : Mesh(CookedMesh::cook(std::move(vertices), std::move(indices), format, std::move(lods)), std::move(textures), retention, targetArena)
+    {
+    }
 
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    // uploads a cooked mesh as it is. With GeometryRetention::Keep the vertices and indices it was cooked from
+    // stay, a mesh from the cache has none
+    Mesh(CookedMesh cooked, vector<Texture> textures, GeometryRetention retention = GeometryRetention::Keep, GeometryArena& targetArena = GeometryArena::global())
+        : textures(std::move(textures)), lods(std::move(cooked.lods)), bounds(cooked.bounds), meshlets(std::move(cooked.meshlets)),
+        format(cooked.format), indexType(cooked.indexType), arena(&targetArena)
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
+        vertexCount = cooked.vertexCount;
+        positionCount = cooked.positionCount;
+        indexCount = lods[0].indexCount;
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        setupMesh(cooked);
+
+        if (retention == GeometryRetention::Keep)
+        {
+            vertices = std::move(cooked.sourceVertices);
+            indices = std::move(cooked.sourceIndices);
+        }
+    }
+
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    Mesh(Mesh&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    Mesh& operator=(Mesh&& other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            vertices = std::move(other.vertices);
+            indices = std::move(other.indices);
+            textures = std::move(other.textures);
+            samplerNames = std::move(other.samplerNames);
+            vertexCount = other.vertexCount;
+            positionCount = other.positionCount;
+            indexCount = other.indexCount;
+            lods = std::move(other.lods);
+            bounds = other.bounds;
+            meshlets = std::move(other.meshlets);
+            format = other.format;
+            indexType = other.indexType;
+            VAO = other.VAO;
+            positionVAO = other.positionVAO;
+            arena = other.arena;
+            allocation = other.allocation;
+            positionAllocation = other.positionAllocation;
+            other.VAO = 0;
+            other.positionVAO = 0;
+            other.allocation = GeometryArena::INVALID;
+            other.positionAllocation = GeometryArena::INVALID;
+        }
+        return *this;
     }
 
-    // render the mesh
-    void Draw(Shader& shader)
+    ~Mesh()
+    {
+        release();
+    }
+
+    // render the mesh. With culling only the meshlets it leaves visible are drawn,
+    // with a LOD selector as well the level is picked from the distance to the camera
+    void Draw(Shader& shader, const MeshletCulling* culling = nullptr, const LodSelector* lod = nullptr)
+    {
+        bindTextures(shader);
+        drawGeometry(VAO, allocation, culling, culling && lod ? lod->select(lods, distanceTo(culling->camera)) : 0);
+    }
+
+    // render the positions only, 12 bytes fetched per vertex. For passes whose vertex shader reads nothing
+    // but aPos (location 0), like the outline, depth or shadow passes. Textures are left alone
+    void DrawPositions(const MeshletCulling* culling = nullptr, const LodSelector* lod = nullptr)
+    {
+        unsigned int level = culling && lod ? lod->select(lods, distanceTo(culling->camera)) : 0;
+        if (positionAllocation == GeometryArena::INVALID)
+            drawGeometry(VAO, allocation, culling, level);
+        else
+            drawGeometry(positionVAO, positionAllocation, culling, level);
+    }
+
+    // where the mesh, or one of its levels, starts in the arena buffers, for glDraw*BaseVertex
+    void* indexOffset(unsigned int level = 0) const
+    {
+        return indexOffset(allocation, level);
+    }
+    GLint baseVertex() const
+    {
+        return baseVertex(allocation);
+    }
+
+    // bytes of the index buffer on the GPU, every level included
+    size_t indexBufferSize() const
+    {
+        return arena->range(allocation).indexCount * (indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int));
+    }
+
+    // distance from the point to the bounding sphere, object space
+    float distanceTo(const glm::vec3& point) const
+    {
+        return glm::length(point - bounds.center()) - bounds.radius();
+    }
+
+private:
+    // render data 
+    GeometryArena* arena;
+    unsigned int allocation = GeometryArena::INVALID;
+    // positions with their own indices, in the same order so the LOD and meshlet ranges apply unchanged
+    unsigned int positionAllocation = GeometryArena::INVALID;
+    // sampler uniform name of each texture (diffuse_textureN etc.), built once instead of every draw
+    vector<string> samplerNames;
+    // ranges of a culled draw, kept to not allocate every frame
+    vector<GLsizei> drawCounts;
+    vector<const void*> drawOffsets;
+    vector<GLint> drawBaseVertices;
+
+    void bindTextures(Shader& shader)
     {
         // bind appropriate textures
+        for (unsigned int i = 0; i < textures.size(); i++)
+        {
+            GLState::activeTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
+            // now set the sampler to the correct texture unit
+            shader.setInt(samplerNames[i], i);
+            // and finally bind the texture
+            GLState::bindTexture(GL_TEXTURE_2D, textures[i].id);
+        }
+    }
+
+    // draws the geometry of one allocation, the full layout or the position stream, at the given level
+    void drawGeometry(unsigned int vertexArray, unsigned int geometry, const MeshletCulling* culling, unsigned int level)
+    {
+        // draw mesh. Nothing is unbound afterwards, the next draw only changes what differs
+        // and meshes of the same format don't even switch the VAO
+        GLState::bindVertexArray(vertexArray);
+        // meshlets are only built for the full mesh, a coarser level is drawn whole
+        if (level > 0)
+        {
+            meshletStats.trianglesDrawn += lods[level].indexCount / 3;
+            meshletStats.trianglesSimplified += (lods[0].indexCount - lods[level].indexCount) / 3;
+            glDrawElementsBaseVertex(GL_TRIANGLES, lods[level].indexCount, indexType, indexOffset(geometry, level), baseVertex(geometry));
+            return;
+        }
+        if (!culling)
+        {
+            glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<unsigned int>(indexCount), indexType, indexOffset(geometry, 0), baseVertex(geometry));
+            return;
+        }
+
+        // surviving meshlets next to each other in the index buffer are merged into one range
+        drawCounts.clear();
+        drawOffsets.clear();
+        size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+        size_t firstIndex = arena->range(geometry).firstIndex;
+        unsigned int rangeEnd = 0;
+        for (const Meshlet& meshlet : meshlets)
+        {
+            if (!culling->visible(meshlet))
+            {
+                meshletStats.meshletsCulled++;
+                meshletStats.trianglesCulled += meshlet.indexCount / 3;
+                continue;
+            }
+            meshletStats.meshletsDrawn++;
+            meshletStats.trianglesDrawn += meshlet.indexCount / 3;
+            if (!drawCounts.empty() && rangeEnd == meshlet.firstIndex)
+                drawCounts.back() += meshlet.indexCount;
+            else
+            {
+                drawCounts.push_back(meshlet.indexCount);
+                drawOffsets.push_back((void*)((firstIndex + meshlet.firstIndex) * indexSize));
+            }
+            rangeEnd = meshlet.firstIndex + meshlet.indexCount;
+        }
+        if (drawCounts.empty())
+            return;
+        drawBaseVertices.assign(drawCounts.size(), baseVertex(geometry));
+        glMultiDrawElementsBaseVertex(GL_TRIANGLES, drawCounts.data(), indexType, drawOffsets.data(), static_cast<GLsizei>(drawCounts.size()), drawBaseVertices.data());
+    }
+
+    void* indexOffset(unsigned int geometry, unsigned int level) const
+    {
+        size_t first = arena->range(geometry).firstIndex + lods[level].firstIndex;
+        return (void*)(first * (indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int)));
+    }
+    GLint baseVertex(unsigned int geometry) const
+    {
+        return static_cast<GLint>(arena->range(geometry).firstVertex);
+    }
+
+    // gives the geometry back to the arena, nothing to do for a moved-from mesh
+    void release()
+    {
+        if (allocation != GeometryArena::INVALID)
+            arena->free(allocation);
+        if (positionAllocation != GeometryArena::INVALID)
+            arena->free(positionAllocation);
+        allocation = GeometryArena::INVALID;
+        positionAllocation = GeometryArena::INVALID;
+        VAO = 0;
+        positionVAO = 0;
+    }
+
+    // initializes all the buffer objects/arrays
+    void setupMesh(const CookedMesh& cooked)
+    {
         unsigned int diffuseNr = 1;
         unsigned int specularNr = 1;
         unsigned int normalNr = 1;
         unsigned int heightNr = 1;
         for (unsigned int i = 0; i < textures.size(); i++)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
             // retrieve texture number (the N in diffuse_textureN)
             string number;
             string name = textures[i].type;
@@ -74,68 +287,17 @@ public:
                 number = std::to_string(normalNr++); // transfer unsigned int to string
             else if (name == "texture_height")
                 number = std::to_string(heightNr++); // transfer unsigned int to string
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            samplerNames.push_back(name + number);
         }
 
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+        // the packed vertices and indices go into the arena pool of their layout as they are
+        allocation = arena->allocate(format, indexType, cooked.vertices.data, vertexCount, cooked.indices.data, cooked.indexCount());
+        VAO = arena->vertexArray(allocation);
 
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+        if (positionCount == 0)
+            return;
+        positionAllocation = arena->allocate(VertexFormat::positionOnly(), indexType, cooked.positions.data, positionCount,
+            cooked.positionIndices.data, cooked.positionIndices.size / cooked.indexSize());
+        positionVAO = arena->vertexArray(positionAllocation);
     }
-
-private:
-    // render data 
-    unsigned int VBO, EBO;
-
-    // initializes all the buffer objects/arrays
-    void setupMesh()
-    {
-        // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-        // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-        // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-        // ids
-        glEnableVertexAttribArray(5);
-        glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, m_BoneIDs));
-
-        // weights
-        glEnableVertexAttribArray(6);
-        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
-        glBindVertexArray(0);
-    }
-};
\ No newline at end of file
+};
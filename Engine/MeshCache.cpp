@@ -0,0 +1,409 @@
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace MeshCache
+{
+    Stats stats;
+
+    namespace
+    {
+        const char* CACHE_DIRECTORY = "./mesh_cache";
+        const uint32_t FILE_MAGIC = 0x314B434D; // "MCK1"
+        // bump whenever cooking, the optimizer or the simplifier change their output. The struct sizes and limits
+        // they depend on are part of the key as well, see makeKey
+        const uint32_t FORMAT_VERSION = 2;
+
+        struct FileHeader
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint64_t key;
+            uint32_t meshCount;
+            uint32_t reserved;
+        };
+
+        // followed by the lods, meshlets and textures, then the four blobs. Everything starts 4 byte aligned
+        struct MeshHeader
+        {
+            uint32_t format; // normals, texCoords, tangents, skinned as bits 0-3
+            uint32_t indexType;
+            uint64_t vertexCount;
+            uint64_t positionCount;
+            uint32_t lodCount;
+            uint32_t meshletCount;
+            uint32_t textureCount;
+            uint32_t reserved;
+            float boundsMin[3];
+            float boundsMax[3];
+            uint64_t vertexBytes;
+            uint64_t indexBytes;
+            uint64_t positionBytes;
+            uint64_t positionIndexBytes;
+        };
+
+        // FNV-1a, same as the program binary cache
+        void hashBytes(uint64_t& hash, const char* data, size_t size)
+        {
+            for (size_t i = 0; i < size; i++)
+            {
+                hash ^= (unsigned char)data[i];
+                hash *= 1099511628211ull;
+            }
+        }
+
+        // false if the file can't be read
+        bool hashFile(uint64_t& hash, const std::string& path)
+        {
+            std::ifstream file(path, std::ios::binary);
+            if (!file)
+                return false;
+            char buffer[1 << 16];
+            while (file)
+            {
+                file.read(buffer, sizeof(buffer));
+                hashBytes(hash, buffer, (size_t)file.gcount());
+            }
+            hashBytes(hash, "\0", 1);
+            return true;
+        }
+
+        std::string pathOf(const std::string& source)
+        {
+            uint64_t hash = 14695981039346656037ull;
+            hashBytes(hash, source.data(), source.size());
+            std::stringstream path;
+            path << CACHE_DIRECTORY << "/" << std::hex << hash << ".mesh";
+            return path.str();
+        }
+
+        size_t aligned(size_t size)
+        {
+            return (size + 3) & ~size_t(3);
+        }
+
+        // walks the mapped file, every read checked against its end
+        struct Reader
+        {
+            const unsigned char* data;
+            size_t size;
+            size_t offset = 0;
+
+            const unsigned char* take(size_t count)
+            {
+                if (count > size - offset)
+                    return nullptr;
+                const unsigned char* at = data + offset;
+                offset = std::min(size, offset + aligned(count));
+                return at;
+            }
+
+            template <typename T>
+            bool read(T& value)
+            {
+                const unsigned char* at = take(sizeof(T));
+                if (at)
+                    std::memcpy(&value, at, sizeof(T));
+                return at != nullptr;
+            }
+
+            template <typename T>
+            bool readArray(std::vector<T>& values, size_t count)
+            {
+                const unsigned char* at = take(count * sizeof(T));
+                if (!at)
+                    return false;
+                values.resize(count);
+                if (count)
+                    std::memcpy(values.data(), at, count * sizeof(T));
+                return true;
+            }
+
+            bool readString(std::string& value)
+            {
+                uint32_t length;
+                if (!read(length))
+                    return false;
+                const unsigned char* at = take(length);
+                if (!at)
+                    return false;
+                value.assign((const char*)at, length);
+                return true;
+            }
+
+            bool readBlob(Blob& blob, uint64_t count)
+            {
+                blob.data = take((size_t)count);
+                blob.size = (size_t)count;
+                return blob.data != nullptr || count == 0;
+            }
+        };
+
+        void write(std::ofstream& file, const void* data, size_t size)
+        {
+            static const char padding[4] = {};
+            if (size)
+                file.write((const char*)data, size);
+            file.write(padding, aligned(size) - size);
+        }
+
+        void writeString(std::ofstream& file, const std::string& value)
+        {
+            uint32_t length = (uint32_t)value.size();
+            write(file, &length, sizeof(length));
+            write(file, value.data(), value.size());
+        }
+
+        // whether the counts in the header agree with the blobs and ranges read after it. A damaged file can be
+        // long enough to read and still point the draws past the end of its buffers
+        bool consistent(const MeshHeader& header, const CookedMesh& mesh)
+        {
+            if (header.indexType != GL_UNSIGNED_SHORT && header.indexType != GL_UNSIGNED_INT)
+                return false;
+            if (header.vertexCount > header.vertexBytes || header.vertexBytes != header.vertexCount * mesh.format.stride())
+                return false;
+            uint64_t indexSize = header.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+            if (header.indexBytes % indexSize != 0)
+                return false;
+            uint64_t indexCount = header.indexBytes / indexSize;
+            for (const MeshLod& lod : mesh.lods)
+            {
+                if ((uint64_t)lod.firstIndex + lod.indexCount > indexCount)
+                    return false;
+            }
+            for (const Meshlet& meshlet : mesh.meshlets)
+            {
+                if ((uint64_t)meshlet.firstIndex + meshlet.indexCount > indexCount)
+                    return false;
+            }
+            // the position stream is either absent or indexes the same triangles
+            if (header.positionBytes != header.positionCount * sizeof(glm::vec3) || header.positionCount > header.positionBytes)
+                return false;
+            return header.positionIndexBytes == (header.positionCount ? header.indexBytes : 0);
+        }
+    }
+
+    MappedFile::~MappedFile()
+    {
+        close();
+    }
+
+    bool MappedFile::open(const std::string& path)
+    {
+        close();
+#ifdef _WIN32
+        HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (handle == INVALID_HANDLE_VALUE)
+            return false;
+        file = handle;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(handle, &fileSize) || fileSize.QuadPart == 0)
+        {
+            close();
+            return false;
+        }
+        mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!mapping)
+        {
+            close();
+            return false;
+        }
+        bytes = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!bytes)
+        {
+            close();
+            return false;
+        }
+        length = (size_t)fileSize.QuadPart;
+#else
+        int descriptor = ::open(path.c_str(), O_RDONLY);
+        if (descriptor < 0)
+            return false;
+        struct stat info;
+        if (fstat(descriptor, &info) != 0 || info.st_size == 0)
+        {
+            ::close(descriptor);
+            return false;
+        }
+        void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        // the mapping stays valid without the descriptor
+        ::close(descriptor);
+        if (view == MAP_FAILED)
+            return false;
+        bytes = (const unsigned char*)view;
+        length = (size_t)info.st_size;
+#endif
+        return true;
+    }
+
+    void MappedFile::close()
+    {
+#ifdef _WIN32
+        if (bytes)
+            UnmapViewOfFile(bytes);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file)
+            CloseHandle(file);
+        mapping = nullptr;
+        file = nullptr;
+#else
+        if (bytes)
+            munmap((void*)bytes, length);
+#endif
+        bytes = nullptr;
+        length = 0;
+    }
+
+    uint64_t makeKey(const std::string& path, unsigned int importFlags)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        hashFile(hash, path);
+        std::filesystem::path material(path);
+        material.replace_extension(".mtl");
+        hashFile(hash, material.string());
+        hashBytes(hash, (const char*)&importFlags, sizeof(importFlags));
+        hashBytes(hash, (const char*)&FORMAT_VERSION, sizeof(FORMAT_VERSION));
+        // a change to any of these alters the cooked output without anyone remembering the version
+        const uint64_t layout[] = { sizeof(Vertex), sizeof(Meshlet), sizeof(MeshLod), MeshSimplifier::MAX_LODS,
+            MeshOptimizer::CACHE_SIZE, Meshlets::MAX_VERTICES, Meshlets::MAX_TRIANGLES };
+        hashBytes(hash, (const char*)layout, sizeof(layout));
+        return hash;
+    }
+
+    bool load(const std::string& path, uint64_t key, MappedFile& file, std::vector<CookedMesh>& meshes)
+    {
+        meshes.clear();
+        FileHeader header;
+        if (!file.open(pathOf(path)))
+        {
+            stats.misses++;
+            return false;
+        }
+        Reader reader{ file.data(), file.size() };
+        if (!reader.read(header) || header.magic != FILE_MAGIC || header.version != FORMAT_VERSION || header.key != key)
+        {
+            file.close();
+            stats.misses++;
+            return false;
+        }
+
+        // a count the file can't possibly hold means it is damaged
+        if (header.meshCount > file.size() / sizeof(MeshHeader))
+        {
+            std::cout << "ERROR::MESH_CACHE::FILE_CORRUPT " << pathOf(path) << std::endl;
+            file.close();
+            stats.misses++;
+            return false;
+        }
+        meshes.resize(header.meshCount);
+        for (CookedMesh& mesh : meshes)
+        {
+            MeshHeader meshHeader;
+            bool valid = reader.read(meshHeader)
+                && reader.readArray(mesh.lods, meshHeader.lodCount)
+                && reader.readArray(mesh.meshlets, meshHeader.meshletCount);
+            if (valid)
+            {
+                mesh.textures.resize(meshHeader.textureCount);
+                for (Texture& texture : mesh.textures)
+                {
+                    texture.id = 0;
+                    valid = valid && reader.readString(texture.type) && reader.readString(texture.path);
+                }
+            }
+            valid = valid && reader.readBlob(mesh.vertices, meshHeader.vertexBytes)
+                && reader.readBlob(mesh.indices, meshHeader.indexBytes)
+                && reader.readBlob(mesh.positions, meshHeader.positionBytes)
+                && reader.readBlob(mesh.positionIndices, meshHeader.positionIndexBytes);
+            mesh.format.normals = (meshHeader.format & 1) != 0;
+            mesh.format.texCoords = (meshHeader.format & 2) != 0;
+            mesh.format.tangents = (meshHeader.format & 4) != 0;
+            mesh.format.skinned = (meshHeader.format & 8) != 0;
+            if (!valid || mesh.lods.empty() || !consistent(meshHeader, mesh))
+            {
+                std::cout << "ERROR::MESH_CACHE::FILE_CORRUPT " << pathOf(path) << std::endl;
+                meshes.clear();
+                file.close();
+                stats.misses++;
+                return false;
+            }
+
+            mesh.indexType = meshHeader.indexType;
+            mesh.vertexCount = (size_t)meshHeader.vertexCount;
+            mesh.positionCount = (size_t)meshHeader.positionCount;
+            mesh.bounds = Bounds(glm::vec3(meshHeader.boundsMin[0], meshHeader.boundsMin[1], meshHeader.boundsMin[2]),
+                glm::vec3(meshHeader.boundsMax[0], meshHeader.boundsMax[1], meshHeader.boundsMax[2]));
+        }
+        stats.hits++;
+        return true;
+    }
+
+    void store(const std::string& path, uint64_t key, const std::vector<CookedMesh>& meshes)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(CACHE_DIRECTORY, error);
+        std::ofstream file(pathOf(path), std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            std::cout << "ERROR::MESH_CACHE::FILE_NOT_SUCCESFULLY_WRITTEN " << pathOf(path) << std::endl;
+            return;
+        }
+
+        FileHeader header = { FILE_MAGIC, FORMAT_VERSION, key, (uint32_t)meshes.size(), 0 };
+        write(file, &header, sizeof(header));
+        for (const CookedMesh& mesh : meshes)
+        {
+            MeshHeader meshHeader = {};
+            meshHeader.format = (mesh.format.normals ? 1 : 0) | (mesh.format.texCoords ? 2 : 0) | (mesh.format.tangents ? 4 : 0) | (mesh.format.skinned ? 8 : 0);
+            meshHeader.indexType = mesh.indexType;
+            meshHeader.vertexCount = mesh.vertexCount;
+            meshHeader.positionCount = mesh.positionCount;
+            meshHeader.lodCount = (uint32_t)mesh.lods.size();
+            meshHeader.meshletCount = (uint32_t)mesh.meshlets.size();
+            meshHeader.textureCount = (uint32_t)mesh.textures.size();
+            for (int axis = 0; axis < 3; axis++)
+            {
+                meshHeader.boundsMin[axis] = mesh.bounds.min[axis];
+                meshHeader.boundsMax[axis] = mesh.bounds.max[axis];
+            }
+            meshHeader.vertexBytes = mesh.vertices.size;
+            meshHeader.indexBytes = mesh.indices.size;
+            meshHeader.positionBytes = mesh.positions.size;
+            meshHeader.positionIndexBytes = mesh.positionIndices.size;
+
+            write(file, &meshHeader, sizeof(meshHeader));
+            write(file, mesh.lods.data(), mesh.lods.size() * sizeof(MeshLod));
+            write(file, mesh.meshlets.data(), mesh.meshlets.size() * sizeof(Meshlet));
+            for (const Texture& texture : mesh.textures)
+            {
+                writeString(file, texture.type);
+                writeString(file, texture.path);
+            }
+            write(file, mesh.vertices.data, mesh.vertices.size);
+            write(file, mesh.indices.data, mesh.indices.size);
+            write(file, mesh.positions.data, mesh.positions.size);
+            write(file, mesh.positionIndices.data, mesh.positionIndices.size);
+        }
+        if (!file)
+            std::cout << "ERROR::MESH_CACHE::FILE_NOT_SUCCESFULLY_WRITTEN " << pathOf(path) << std::endl;
+    }
+}
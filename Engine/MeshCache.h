@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "CookedMesh.h"
+
+// On-disk cache of the cooked meshes of a model, so a warm start skips assimp and every processing step.
+// One file per source path. The key hashes the source file, its material library, the import flags and the
+// format version, so editing the model or changing how it is imported simply misses and cooks it again.
+// Files are memory mapped and the blobs of the cooked meshes point into the mapping
+namespace MeshCache
+{
+    // models are staged on worker threads, so the counters are atomic
+    struct Stats
+    {
+        std::atomic<unsigned int> hits{ 0 };
+        std::atomic<unsigned int> misses{ 0 };
+    };
+    extern Stats stats;
+
+    // a read-only file mapped into memory, unmapped when destroyed
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool open(const std::string& path);
+        void close();
+        const unsigned char* data() const { return bytes; }
+        size_t size() const { return length; }
+
+    private:
+        const unsigned char* bytes = nullptr;
+        size_t length = 0;
+#ifdef _WIN32
+        void* file = nullptr;
+        void* mapping = nullptr;
+#endif
+    };
+
+    // hash of the source file, its .mtl of the same name if there is one, the import flags and the format version
+    uint64_t makeKey(const std::string& path, unsigned int importFlags);
+    // maps the cache file of path and reads the meshes out of it, false if there is none or it is stale.
+    // The blobs of the meshes point into file, which has to stay open until they are uploaded
+    bool load(const std::string& path, uint64_t key, MappedFile& file, std::vector<CookedMesh>& meshes);
+    // writes the meshes as the cache file of path
+    void store(const std::string& path, uint64_t key, const std::vector<CookedMesh>& meshes);
+}
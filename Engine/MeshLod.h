@@ -0,0 +1,45 @@
+#pragma once
+
+#include <glm/glm/glm.hpp>
+
+#include <algorithm>
+#include <vector>
+
+// one level of detail of a mesh, a range of its index buffer drawn with the same vertices
+struct MeshLod
+{
+    // relative to the first index of the mesh
+    unsigned int firstIndex;
+    unsigned int indexCount;
+    // how far the simplified surface may be from the original, object space units. 0 for the full mesh
+    float error;
+};
+
+// Picks the coarsest level whose error stays below a pixel threshold once projected
+struct LodSelector
+{
+    // pixels covered by one unit at distance one, 0 always selects the full mesh
+    float pixelScale = 0.0f;
+    // largest acceptable projected error in pixels
+    float threshold = 1.0f;
+
+    static LodSelector fromProjection(const glm::mat4& projection, float viewportHeight, float threshold = 1.0f)
+    {
+        LodSelector selector;
+        selector.pixelScale = 0.5f * viewportHeight * projection[1][1];
+        selector.threshold = threshold;
+        return selector;
+    }
+
+    // distance from the camera to the closest point of the mesh, in the units of the errors
+    unsigned int select(const std::vector<MeshLod>& lods, float distance) const
+    {
+        if (pixelScale <= 0.0f)
+            return 0;
+        distance = std::max(distance, 1e-4f);
+        unsigned int level = 0;
+        while (level + 1 < lods.size() && lods[level + 1].error * pixelScale / distance <= threshold)
+            level++;
+        return level;
+    }
+};
@@ -0,0 +1,263 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <unordered_map>
+
+#include <glm/glm/glm.hpp>
+
+namespace
+{
+    // welding compares vertices bitwise, so every field of a Vertex has to be initialized
+    struct VertexHash
+    {
+        size_t operator()(const Vertex& vertex) const
+        {
+            // FNV-1a over the bytes
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&vertex);
+            size_t hash = 14695981039346656037ull;
+            for (size_t i = 0; i < sizeof(Vertex); i++)
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+            return hash;
+        }
+    };
+
+    struct VertexEqual
+    {
+        bool operator()(const Vertex& a, const Vertex& b) const
+        {
+            return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+        }
+    };
+
+    // the next vertex with triangles left: the most recent dead end, otherwise the next one in input order
+    int skipDeadEnd(const std::vector<unsigned int>& liveTriangles, std::vector<unsigned int>& deadEnd, size_t& cursor)
+    {
+        while (!deadEnd.empty())
+        {
+            unsigned int vertex = deadEnd.back();
+            deadEnd.pop_back();
+            if (liveTriangles[vertex] > 0)
+                return vertex;
+        }
+        for (; cursor < liveTriangles.size(); cursor++)
+        {
+            if (liveTriangles[cursor] > 0)
+                return static_cast<int>(cursor);
+        }
+        return -1;
+    }
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::analyze(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize)
+{
+    CacheStats stats;
+    stats.triangles = indices.size() / 3;
+    stats.vertices = vertexCount;
+
+    // miss count at the time each vertex entered the cache, 0 if it never did
+    std::vector<size_t> entered(vertexCount, 0);
+    for (unsigned int index : indices)
+    {
+        if (entered[index] == 0 || stats.transformed - entered[index] >= cacheSize)
+            entered[index] = ++stats.transformed;
+    }
+    return stats;
+}
+
+void MeshOptimizer::weld(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+    std::unordered_map<Vertex, unsigned int, VertexHash, VertexEqual> unique;
+    unique.reserve(vertices.size());
+    std::vector<unsigned int> remap(vertices.size());
+    std::vector<Vertex> welded;
+    welded.reserve(vertices.size());
+
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        auto found = unique.emplace(vertices[i], static_cast<unsigned int>(welded.size()));
+        if (found.second)
+            welded.push_back(vertices[i]);
+        remap[i] = found.first->second;
+    }
+    for (unsigned int& index : indices)
+        index = remap[index];
+    vertices.swap(welded);
+}
+
+std::vector<unsigned int> MeshOptimizer::reorderForCache(const std::vector<unsigned int>& indices, size_t vertexCount, std::vector<size_t>& clusters)
+{
+    size_t triangleCount = indices.size() / 3;
+
+    // triangles of every vertex, packed into one array
+    std::vector<unsigned int> liveTriangles(vertexCount, 0);
+    for (unsigned int index : indices)
+        liveTriangles[index]++;
+    std::vector<size_t> adjacencyStart(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+        adjacencyStart[v + 1] = adjacencyStart[v] + liveTriangles[v];
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<size_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        for (size_t k = 0; k < 3; k++)
+            adjacency[fill[indices[t * 3 + k]]++] = static_cast<unsigned int>(t);
+    }
+
+    // time each vertex last entered the simulated cache, the clock advances on every miss
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    unsigned int time = CACHE_SIZE + 1;
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> deadEnd;
+    std::vector<unsigned int> candidates;
+    size_t cursor = 0;
+
+    std::vector<unsigned int> result;
+    result.reserve(triangleCount * 3);
+    int fanning = skipDeadEnd(liveTriangles, deadEnd, cursor);
+    if (fanning >= 0)
+        clusters.push_back(0);
+    while (fanning >= 0)
+    {
+        // emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (size_t a = adjacencyStart[fanning]; a < adjacencyStart[fanning + 1]; a++)
+        {
+            unsigned int triangle = adjacency[a];
+            if (emitted[triangle])
+                continue;
+            for (size_t k = 0; k < 3; k++)
+            {
+                unsigned int vertex = indices[triangle * 3 + k];
+                result.push_back(vertex);
+                deadEnd.push_back(vertex);
+                candidates.push_back(vertex);
+                liveTriangles[vertex]--;
+                if (time - cacheTime[vertex] > CACHE_SIZE)
+                    cacheTime[vertex] = time++;
+            }
+            emitted[triangle] = true;
+        }
+
+        // continue with the candidate that has been in the cache longest and will still be there
+        // once its triangles are emitted, any one with triangles left otherwise
+        int next = -1;
+        int bestPriority = -1;
+        for (unsigned int vertex : candidates)
+        {
+            if (liveTriangles[vertex] == 0)
+                continue;
+            int priority = 0;
+            if (time - cacheTime[vertex] + 2 * liveTriangles[vertex] <= CACHE_SIZE)
+                priority = static_cast<int>(time - cacheTime[vertex]);
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                next = static_cast<int>(vertex);
+            }
+        }
+        if (next < 0)
+        {
+            next = skipDeadEnd(liveTriangles, deadEnd, cursor);
+            if (next >= 0 && clusters.back() != result.size())
+                clusters.push_back(result.size());
+        }
+        fanning = next;
+    }
+    return result;
+}
+
+void MeshOptimizer::reorderForOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, const std::vector<size_t>& clusters, float threshold)
+{
+    if (clusters.size() < 2)
+        return;
+
+    struct Cluster
+    {
+        size_t begin, end;
+        float sortKey;
+    };
+
+    // area weighted center of the mesh
+    glm::vec3 meshCenter(0.0f);
+    float meshArea = 0.0f;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        const glm::vec3& a = vertices[indices[i]].Position;
+        const glm::vec3& b = vertices[indices[i + 1]].Position;
+        const glm::vec3& c = vertices[indices[i + 2]].Position;
+        float area = glm::length(glm::cross(b - a, c - a));
+        meshCenter += (a + b + c) * (area / 3.0f);
+        meshArea += area;
+    }
+    if (meshArea > 0.0f)
+        meshCenter /= meshArea;
+
+    // how far each cluster faces out of the mesh, the outermost ones are drawn first
+    std::vector<Cluster> sorted;
+    sorted.reserve(clusters.size());
+    for (size_t n = 0; n < clusters.size(); n++)
+    {
+        Cluster cluster = { clusters[n], n + 1 < clusters.size() ? clusters[n + 1] : indices.size(), 0.0f };
+        glm::vec3 center(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for (size_t i = cluster.begin; i < cluster.end; i += 3)
+        {
+            const glm::vec3& a = vertices[indices[i]].Position;
+            const glm::vec3& b = vertices[indices[i + 1]].Position;
+            const glm::vec3& c = vertices[indices[i + 2]].Position;
+            glm::vec3 weightedNormal = glm::cross(b - a, c - a);
+            float triangleArea = glm::length(weightedNormal);
+            center += (a + b + c) * (triangleArea / 3.0f);
+            normal += weightedNormal;
+            area += triangleArea;
+        }
+        float normalLength = glm::length(normal);
+        if (area > 0.0f && normalLength > 0.0f)
+            cluster.sortKey = glm::dot(center / area - meshCenter, normal / normalLength);
+        sorted.push_back(cluster);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (const Cluster& cluster : sorted)
+        result.insert(result.end(), indices.begin() + cluster.begin, indices.begin() + cluster.end);
+
+    // the jumps between clusters cost cache hits, give up the sort if it costs too many
+    size_t cacheOrder = analyze(indices, vertices.size()).transformed;
+    size_t overdrawOrder = analyze(result, vertices.size()).transformed;
+    if (overdrawOrder <= cacheOrder * threshold)
+        indices.swap(result);
+}
+
+void MeshOptimizer::reorderForFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+    std::vector<unsigned int> remap(vertices.size(), UINT_MAX);
+    std::vector<Vertex> ordered;
+    ordered.reserve(vertices.size());
+    for (unsigned int& index : indices)
+    {
+        if (remap[index] == UINT_MAX)
+        {
+            remap[index] = static_cast<unsigned int>(ordered.size());
+            ordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(ordered);
+}
+
+void MeshOptimizer::optimize(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, CacheStats& before, CacheStats& after)
+{
+    before = analyze(indices, vertices.size());
+
+    weld(vertices, indices);
+    std::vector<size_t> clusters;
+    indices = reorderForCache(indices, vertices.size(), clusters);
+    reorderForOverdraw(indices, vertices, clusters);
+    reorderForFetch(vertices, indices);
+
+    after = analyze(indices, vertices.size());
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "VertexFormat.h"
+
+// Post-import mesh optimisation: welding, triangle order for the post-transform vertex cache and for overdraw,
+// and vertex order for fetch locality. Triangles and vertices are only reordered, never changed
+namespace MeshOptimizer
+{
+    // size of the FIFO the cache order is tuned for and the statistics are simulated with
+    const unsigned int CACHE_SIZE = 16;
+
+    // how often the vertex shader runs for an index buffer, summed over meshes with +=
+    struct CacheStats
+    {
+        size_t triangles = 0;
+        size_t vertices = 0;
+        size_t transformed = 0;
+
+        // average cache miss ratio, vertex shader invocations per triangle (0.5 is ideal, 3 is no reuse)
+        float acmr() const { return triangles ? float(transformed) / triangles : 0.0f; }
+        // average transform to vertex ratio, invocations per vertex (1 is ideal)
+        float atvr() const { return vertices ? float(transformed) / vertices : 0.0f; }
+
+        CacheStats& operator+=(const CacheStats& other)
+        {
+            triangles += other.triangles;
+            vertices += other.vertices;
+            transformed += other.transformed;
+            return *this;
+        }
+    };
+
+    // simulates a FIFO cache of cacheSize entries over the triangle list
+    CacheStats analyze(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = CACHE_SIZE);
+
+    // merges bitwise identical vertices and remaps the indices
+    void weld(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+    // Tipsify (Sander et al. 2007), returns the reordered triangle list. The start of every cluster
+    // (where the walk ran into a dead end and jumped) is appended to clusters as an index offset
+    std::vector<unsigned int> reorderForCache(const std::vector<unsigned int>& indices, size_t vertexCount, std::vector<size_t>& clusters);
+    // sorts the clusters so the ones facing away from the mesh center are drawn first and occlude the rest.
+    // Kept in cache order if that would raise the ACMR by more than threshold
+    void reorderForOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, const std::vector<size_t>& clusters, float threshold = 1.05f);
+    // renumbers the vertices in the order the triangles first use them, unreferenced ones are dropped
+    void reorderForFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+    // every pass above in order, the statistics of the mesh as imported and as optimised are returned through before and after
+    void optimize(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, CacheStats& before, CacheStats& after);
+}
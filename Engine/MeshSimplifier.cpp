@@ -0,0 +1,293 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+    // sum of squared distances to a set of planes, each weighted by the area of its triangle
+    struct Quadric
+    {
+        double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+        double weight = 0;
+
+        void addPlane(const glm::dvec3& n, double d, double w)
+        {
+            a2 += w * n.x * n.x; ab += w * n.x * n.y; ac += w * n.x * n.z; ad += w * n.x * d;
+            b2 += w * n.y * n.y; bc += w * n.y * n.z; bd += w * n.y * d;
+            c2 += w * n.z * n.z; cd += w * n.z * d;
+            d2 += w * d * d;
+            weight += w;
+        }
+
+        void add(const Quadric& q)
+        {
+            a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+            b2 += q.b2; bc += q.bc; bd += q.bd;
+            c2 += q.c2; cd += q.cd;
+            d2 += q.d2;
+            weight += q.weight;
+        }
+
+        // root mean square distance of the point to the planes
+        float distance(const glm::vec3& p) const
+        {
+            if (weight <= 0.0)
+                return 0.0f;
+            double x = p.x, y = p.y, z = p.z;
+            double e = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                + c2 * z * z + 2 * cd * z
+                + d2;
+            return static_cast<float>(std::sqrt(std::max(0.0, e / weight)));
+        }
+    };
+
+    // moving vertex from onto vertex to
+    struct Collapse
+    {
+        unsigned int from;
+        unsigned int to;
+        float cost;
+    };
+
+    struct PositionHash
+    {
+        size_t operator()(const glm::vec3& p) const
+        {
+            // + 0.0f turns -0 into 0, which compares equal and has to hash the same
+            float values[3] = { p.x + 0.0f, p.y + 0.0f, p.z + 0.0f };
+            uint32_t bits[3];
+            std::memcpy(bits, values, sizeof(bits));
+            return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+        }
+    };
+
+    glm::vec3 triangleNormal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+    {
+        return glm::cross(b - a, c - a);
+    }
+}
+
+std::vector<unsigned int> MeshSimplifier::simplify(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+    size_t targetIndexCount, float maxError, float& error)
+{
+    error = 0.0f;
+    std::vector<unsigned int> result(indices);
+    if (result.size() <= targetIndexCount)
+        return result;
+
+    // vertices sharing a position are one point of the surface, the first of them stands for all
+    std::vector<unsigned int> positionOf(vertices.size());
+    std::vector<unsigned int> verticesAt(vertices.size(), 0);
+    {
+        std::unordered_map<glm::vec3, unsigned int, PositionHash> positions;
+        positions.reserve(vertices.size());
+        for (size_t v = 0; v < vertices.size(); v++)
+            positionOf[v] = positions.emplace(vertices[v].Position, static_cast<unsigned int>(v)).first->second;
+    }
+    {
+        std::vector<bool> referenced(vertices.size(), false);
+        for (unsigned int index : indices)
+            referenced[index] = true;
+        for (size_t v = 0; v < vertices.size(); v++)
+        {
+            if (referenced[v])
+                verticesAt[positionOf[v]]++;
+        }
+    }
+
+    // seams have several vertices at one position, borders and non-manifold edges aren't shared by exactly two triangles
+    std::vector<bool> locked(vertices.size(), false);
+    for (size_t v = 0; v < vertices.size(); v++)
+        locked[v] = verticesAt[positionOf[v]] > 1;
+    {
+        std::unordered_map<uint64_t, unsigned int> edgeUses;
+        edgeUses.reserve(indices.size());
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            for (size_t k = 0; k < 3; k++)
+            {
+                uint64_t a = positionOf[indices[i + k]], b = positionOf[indices[i + (k + 1) % 3]];
+                edgeUses[std::min(a, b) << 32 | std::max(a, b)]++;
+            }
+        }
+        for (const auto& edge : edgeUses)
+        {
+            if (edge.second != 2)
+            {
+                locked[edge.first >> 32] = true;
+                locked[edge.first & 0xffffffffu] = true;
+            }
+        }
+        for (size_t v = 0; v < vertices.size(); v++)
+            locked[v] = locked[v] || locked[positionOf[v]];
+    }
+
+    std::vector<Quadric> quadrics(vertices.size());
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        glm::dvec3 a = vertices[indices[i]].Position, b = vertices[indices[i + 1]].Position, c = vertices[indices[i + 2]].Position;
+        glm::dvec3 normal = glm::cross(b - a, c - a);
+        double length = glm::length(normal);
+        if (length <= 0.0)
+            continue;
+        normal /= length;
+        for (size_t k = 0; k < 3; k++)
+            quadrics[positionOf[indices[i + k]]].addPlane(normal, -glm::dot(normal, a), length * 0.5);
+    }
+
+    std::vector<bool> touched(vertices.size());
+    std::vector<size_t> adjacencyStart(vertices.size() + 1);
+    std::vector<unsigned int> adjacency;
+    std::vector<Collapse> collapses;
+    while (result.size() > targetIndexCount)
+    {
+        // triangles of every vertex
+        std::fill(adjacencyStart.begin(), adjacencyStart.end(), 0);
+        for (unsigned int index : result)
+            adjacencyStart[index + 1]++;
+        for (size_t v = 0; v < vertices.size(); v++)
+            adjacencyStart[v + 1] += adjacencyStart[v];
+        adjacency.resize(result.size());
+        std::vector<size_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+        for (size_t i = 0; i < result.size(); i++)
+            adjacency[fill[result[i]]++] = static_cast<unsigned int>(i / 3);
+
+        // every edge both ways, cheapest first
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            for (size_t k = 0; k < 3; k++)
+            {
+                unsigned int a = result[i + k], b = result[i + (k + 1) % 3];
+                for (int direction = 0; direction < 2; direction++)
+                {
+                    unsigned int from = direction ? b : a, to = direction ? a : b;
+                    if (locked[from] || positionOf[from] == positionOf[to])
+                        continue;
+                    Quadric merged = quadrics[positionOf[from]];
+                    merged.add(quadrics[positionOf[to]]);
+                    collapses.push_back({ from, to, merged.distance(vertices[to].Position) });
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+        // collapse greedily, every vertex at most once per pass so the adjacency stays valid
+        std::fill(touched.begin(), touched.end(), false);
+        size_t wanted = (result.size() - targetIndexCount) / 3;
+        size_t removed = 0;
+        bool collapsed = false;
+        for (const Collapse& collapse : collapses)
+        {
+            if (collapse.cost > maxError || removed >= wanted)
+                break;
+            if (touched[collapse.from] || touched[collapse.to])
+                continue;
+
+            // the triangles that stay must not flip
+            bool flips = false;
+            const glm::vec3& target = vertices[collapse.to].Position;
+            for (size_t a = adjacencyStart[collapse.from]; a < adjacencyStart[collapse.from + 1] && !flips; a++)
+            {
+                const unsigned int* triangle = &result[adjacency[a] * 3];
+                glm::vec3 corners[3];
+                bool degenerates = false;
+                for (size_t k = 0; k < 3; k++)
+                {
+                    corners[k] = vertices[triangle[k]].Position;
+                    degenerates = degenerates || positionOf[triangle[k]] == positionOf[collapse.to];
+                }
+                if (degenerates)
+                    continue;
+                glm::vec3 before = triangleNormal(corners[0], corners[1], corners[2]);
+                for (size_t k = 0; k < 3; k++)
+                {
+                    if (triangle[k] == collapse.from)
+                        corners[k] = target;
+                }
+                flips = glm::dot(before, triangleNormal(corners[0], corners[1], corners[2])) <= 0.0f;
+            }
+            if (flips)
+                continue;
+
+            for (size_t a = adjacencyStart[collapse.from]; a < adjacencyStart[collapse.from + 1]; a++)
+            {
+                unsigned int* triangle = &result[adjacency[a] * 3];
+                bool degenerates = false;
+                for (size_t k = 0; k < 3; k++)
+                {
+                    degenerates = degenerates || positionOf[triangle[k]] == positionOf[collapse.to];
+                    touched[triangle[k]] = true;
+                }
+                for (size_t k = 0; k < 3; k++)
+                {
+                    if (triangle[k] == collapse.from)
+                        triangle[k] = collapse.to;
+                }
+                if (degenerates)
+                    removed++;
+            }
+            quadrics[positionOf[collapse.to]].add(quadrics[positionOf[collapse.from]]);
+            touched[collapse.to] = true;
+            error = std::max(error, collapse.cost);
+            collapsed = true;
+        }
+        if (!collapsed)
+            break;
+
+        // drop the triangles that collapsed to a line
+        size_t kept = 0;
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            unsigned int a = positionOf[result[i]], b = positionOf[result[i + 1]], c = positionOf[result[i + 2]];
+            if (a == b || b == c || a == c)
+                continue;
+            for (size_t k = 0; k < 3; k++)
+                result[kept++] = result[i + k];
+        }
+        result.resize(kept);
+    }
+    return result;
+}
+
+std::vector<unsigned int> MeshSimplifier::buildLods(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, std::vector<MeshLod>& lods)
+{
+    std::vector<unsigned int> chain(indices);
+    lods.clear();
+    lods.push_back({ 0, static_cast<unsigned int>(indices.size()), 0.0f });
+    if (vertices.empty())
+        return chain;
+
+    // a level may move the surface by at most a tenth of the mesh size, coarser ones would be useless anyway
+    glm::vec3 boundsMin = vertices[0].Position, boundsMax = vertices[0].Position;
+    for (const Vertex& vertex : vertices)
+    {
+        boundsMin = glm::min(boundsMin, vertex.Position);
+        boundsMax = glm::max(boundsMax, vertex.Position);
+    }
+    float maxError = 0.1f * glm::length(boundsMax - boundsMin);
+
+    while (lods.size() < MAX_LODS)
+    {
+        size_t target = lods.back().indexCount / 2 / 3 * 3;
+        if (target < 3 * 16)
+            break;
+        float error;
+        std::vector<unsigned int> level = simplify(vertices, indices, target, maxError, error);
+        // locked seams and borders or the error limit stop the simplifier, another level would be the same mesh
+        if (level.size() > lods.back().indexCount * 4 / 5)
+            break;
+
+        std::vector<size_t> clusters;
+        level = MeshOptimizer::reorderForCache(level, vertices.size(), clusters);
+        lods.push_back({ static_cast<unsigned int>(chain.size()), static_cast<unsigned int>(level.size()), std::max(error, lods.back().error) });
+        chain.insert(chain.end(), level.begin(), level.end());
+    }
+    return chain;
+}
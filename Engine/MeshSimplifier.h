@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "MeshLod.h"
+#include "VertexFormat.h"
+
+// Quadric error edge collapse (Garland/Heckbert) restricted to collapsing a vertex onto a neighbour,
+// so the vertex buffer is shared by every level and only the indices change.
+// Vertices on open borders and UV or normal seams stay where they are, which keeps the levels crack free
+namespace MeshSimplifier
+{
+    // levels in a chain, the full mesh included
+    const unsigned int MAX_LODS = 5;
+
+    // collapses edges until at most targetIndexCount indices are left or the next collapse would move the
+    // surface further than maxError. error receives the largest distance error of the collapses done
+    std::vector<unsigned int> simplify(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+        size_t targetIndexCount, float maxError, float& error);
+
+    // the full mesh followed by up to MAX_LODS - 1 levels of about half the triangles of the previous one,
+    // each optimised for the vertex cache. lods receives the ranges of the returned indices
+    std::vector<unsigned int> buildLods(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, std::vector<MeshLod>& lods);
+}
@@ -0,0 +1,121 @@
+#include "Meshlet.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace
+{
+    // bounds and normal cone of the triangles [firstIndex, endIndex)
+    Meshlet finishMeshlet(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, size_t firstIndex, size_t endIndex)
+    {
+        Meshlet meshlet;
+        meshlet.firstIndex = static_cast<unsigned int>(firstIndex);
+        meshlet.indexCount = static_cast<unsigned int>(endIndex - firstIndex);
+
+        glm::vec3 boundsMin = vertices[indices[firstIndex]].Position;
+        glm::vec3 boundsMax = boundsMin;
+        for (size_t i = firstIndex; i < endIndex; i++)
+        {
+            boundsMin = glm::min(boundsMin, vertices[indices[i]].Position);
+            boundsMax = glm::max(boundsMax, vertices[indices[i]].Position);
+        }
+        meshlet.center = (boundsMin + boundsMax) * 0.5f;
+        meshlet.radius = 0.0f;
+        for (size_t i = firstIndex; i < endIndex; i++)
+            meshlet.radius = std::max(meshlet.radius, glm::length(vertices[indices[i]].Position - meshlet.center));
+
+        // the cone axis is the average triangle normal, its angle the widest deviation from it
+        std::vector<glm::vec3> normals;
+        normals.reserve((endIndex - firstIndex) / 3);
+        glm::vec3 axis(0.0f);
+        for (size_t i = firstIndex; i + 2 < endIndex; i += 3)
+        {
+            const glm::vec3& a = vertices[indices[i]].Position;
+            const glm::vec3& b = vertices[indices[i + 1]].Position;
+            const glm::vec3& c = vertices[indices[i + 2]].Position;
+            glm::vec3 normal = glm::cross(b - a, c - a);
+            float length = glm::length(normal);
+            if (length <= 0.0f)
+                continue;
+            normals.push_back(normal / length);
+            axis += normals.back();
+        }
+
+        meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+        meshlet.coneCutoff = 1.0f;
+        float axisLength = glm::length(axis);
+        if (axisLength <= 0.0f)
+            return meshlet;
+        axis /= axisLength;
+        float minDot = 1.0f;
+        for (const glm::vec3& normal : normals)
+            minDot = std::min(minDot, glm::dot(normal, axis));
+        meshlet.coneAxis = axis;
+        if (minDot > 0.0f)
+            meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+        return meshlet;
+    }
+}
+
+MeshletCulling MeshletCulling::forModel(const glm::mat4& viewProjection, const glm::mat4& model, const glm::vec3& cameraPosition)
+{
+    MeshletCulling culling;
+    culling.frustum = Frustum::fromMatrix(viewProjection * model);
+    // which side of a plane a point is on survives any affine transform, so the cone test works in object space too
+    culling.camera = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.0f));
+    return culling;
+}
+
+bool MeshletCulling::visible(const Meshlet& meshlet) const
+{
+    if (!frustum.intersectsSphere(meshlet.center, meshlet.radius))
+        return false;
+
+    // back-facing if the camera is behind the plane of every triangle, widened by the cone angle and the sphere
+    glm::vec3 toMeshlet = meshlet.center - camera;
+    return glm::dot(toMeshlet, meshlet.coneAxis) <= meshlet.coneCutoff * glm::length(toMeshlet) + meshlet.radius;
+}
+
+std::vector<Meshlet> Meshlets::build(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, size_t indexCount)
+{
+    std::vector<Meshlet> meshlets;
+    // meshlet each vertex was last counted in
+    std::vector<unsigned int> counted(vertices.size(), UINT_MAX);
+    unsigned int current = 0;
+    unsigned int vertexCount = 0;
+    size_t firstIndex = 0;
+
+    indexCount -= indexCount % 3;
+    for (size_t i = 0; i < indexCount; i += 3)
+    {
+        unsigned int added = 0;
+        for (size_t k = 0; k < 3; k++)
+        {
+            // a vertex repeated within the triangle is still only one
+            bool repeated = (k > 0 && indices[i + k] == indices[i]) || (k > 1 && indices[i + k] == indices[i + 1]);
+            if (counted[indices[i + k]] != current && !repeated)
+                added++;
+        }
+
+        size_t triangles = (i - firstIndex) / 3;
+        if (vertexCount + added > MAX_VERTICES || triangles + 1 > MAX_TRIANGLES)
+        {
+            meshlets.push_back(finishMeshlet(vertices, indices, firstIndex, i));
+            current++;
+            vertexCount = 0;
+            firstIndex = i;
+        }
+        for (size_t k = 0; k < 3; k++)
+        {
+            if (counted[indices[i + k]] != current)
+            {
+                counted[indices[i + k]] = current;
+                vertexCount++;
+            }
+        }
+    }
+    if (firstIndex < indexCount)
+        meshlets.push_back(finishMeshlet(vertices, indices, firstIndex, indexCount));
+    return meshlets;
+}
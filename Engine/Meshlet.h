@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glm/glm/glm.hpp>
+#include <vector>
+
+#include "Frustum.h"
+#include "VertexFormat.h"
+
+// A run of at most MAX_TRIANGLES consecutive triangles of a mesh touching at most MAX_VERTICES vertices,
+// with the bounds to cull it as a whole. Meshlets are slices of the index buffer in the order
+// the optimizer left it, so the ones that survive culling are drawn as plain index ranges
+struct Meshlet
+{
+    unsigned int firstIndex;
+    unsigned int indexCount;
+    // bounding sphere, object space
+    glm::vec3 center;
+    float radius;
+    // every triangle normal lies within the cone around the axis, coneCutoff is the sine of its half angle.
+    // 1 when the normals spread too far for the cone to cull anything
+    glm::vec3 coneAxis;
+    float coneCutoff;
+};
+
+// meshlets culled and drawn, reset once per frame
+struct MeshletStats
+{
+    unsigned int meshletsDrawn = 0;
+    unsigned int meshletsCulled = 0;
+    unsigned int trianglesDrawn = 0;
+    unsigned int trianglesCulled = 0;
+    // triangles a coarser level of detail left out
+    unsigned int trianglesSimplified = 0;
+};
+
+// the camera as seen from one model, meshlets are tested in object space
+struct MeshletCulling
+{
+    Frustum frustum;
+    glm::vec3 camera;
+
+    static MeshletCulling forModel(const glm::mat4& viewProjection, const glm::mat4& model, const glm::vec3& cameraPosition);
+
+    // false if the meshlet is outside the frustum or all its triangles face away from the camera
+    bool visible(const Meshlet& meshlet) const;
+};
+
+namespace Meshlets
+{
+    const unsigned int MAX_VERTICES = 64;
+    const unsigned int MAX_TRIANGLES = 124;
+
+    // splits the first indexCount indices into meshlets, without reordering them
+    std::vector<Meshlet> build(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, size_t indexCount);
+}
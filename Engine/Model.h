@@ -1,134 +1,293 @@
 #pragma once
 
 #include "Mesh.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "TextureCache.h"
+#include "TextureStreamer.h"
+#include "ThreadPool.h"
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 #include "stb_image.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+
 using namespace std;
 
-unsigned int TextureFromFile(const char* path, const string& directory, bool gamma = false);
+// everything a Model needs from disk, produced without touching GL so it can be built on a worker thread
+struct StagedModel
+{
+    string path;
+    string directory;
+    GeometryRetention retention = GeometryRetention::Release;
+    vector<CookedMesh> meshes;
+    // on a cache hit the blobs of the meshes point into it, so it lives until they are uploaded
+    std::unique_ptr<MeshCache::MappedFile> cacheFile;
+    bool cached = false;
+    bool valid = false;
+    // vertex cache statistics of all meshes as imported and after MeshOptimizer
+    MeshOptimizer::CacheStats cacheBefore, cacheAfter;
+    double stageMilliseconds = 0.0;
+};
+
 
 class Model
 {
 public:
     // model data 
-    vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+    vector<Texture> textures_loaded;	// every texture of the model once, shared with other models through the TextureCache
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    // whether the meshes keep their vertices and indices after upload
+    GeometryRetention retention;
+    // where the meshes put their geometry
+    GeometryArena* arena;
+    // object space box around every mesh
+    Bounds bounds;
+
+    // constructor, expects a filepath to a 3D model. Stages and uploads it on the calling thread
+    Model(string const& path, bool gamma = false, GeometryRetention retention = GeometryRetention::Release, GeometryArena& arena = GeometryArena::global())
+        : Model(stage(path, retention), gamma, arena)
+    {
+    }
+
+    // uploads a model staged on any thread, must run on the GL thread
+    Model(StagedModel staged, bool gamma = false, GeometryArena& arena = GeometryArena::global())
+        : gammaCorrection(gamma), retention(staged.retention), arena(&arena)
+    {
+        upload(staged);
+    }
+
+    // gives the textures back to the TextureCache, each holds one reference of the model
+    ~Model()
+    {
+        for (const Texture& texture : textures_loaded)
+            TextureCache::global().release(texture.id);
+    }
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
 
-    // constructor, expects a filepath to a 3D model.
-    Model(string const& path, bool gamma = false) : gammaCorrection(gamma)
+    // the CPU half of loading: reads the file, or its MeshCache entry, and cooks the meshes.
+    // Touches no GL state, so several models can be staged at once on the ThreadPool
+    static StagedModel stage(string const& path, GeometryRetention retention = GeometryRetention::Release)
     {
-        loadModel(path);
+        auto start = std::chrono::steady_clock::now();
+        StagedModel staged;
+        staged.path = path;
+        staged.retention = retention;
+        // retrieve the directory path of the filepath
+        staged.directory = path.substr(0, path.find_last_of('/'));
+
+        // meshes that keep their CPU copy need the vertices they were cooked from, which the cache doesn't have
+        const unsigned int importFlags = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+        uint64_t cacheKey = MeshCache::makeKey(path, importFlags);
+        staged.cacheFile = std::make_unique<MeshCache::MappedFile>();
+        staged.cached = retention == GeometryRetention::Release && MeshCache::load(path, cacheKey, *staged.cacheFile, staged.meshes);
+        if (!staged.cached)
+        {
+            // read file via ASSIMP
+            Assimp::Importer importer;
+            const aiScene* scene = importer.ReadFile(path, importFlags);
+            // check for errors
+            if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
+            {
+                cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
+                return staged;
+            }
+            // process ASSIMP's root node recursively
+            staged.meshes.reserve(scene->mNumMeshes);
+            // a mesh that throws while it is converted fails this model only, the others keep loading
+            try
+            {
+                processNode(scene->mRootNode, scene, staged);
+            }
+            catch (const std::exception& error)
+            {
+                cout << "ERROR::MODEL::PROCESSING_FAILED " << path << ": " << error.what() << endl;
+                staged.meshes.clear();
+                return staged;
+            }
+            MeshCache::store(path, cacheKey, staged.meshes);
+        }
+
+        staged.valid = true;
+        staged.stageMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return staged;
     }
 
-    // draws the model, and thus all its meshes
+    // draws the model, and thus all its meshes, at full detail. Without a camera there is no distance to pick a level from
     void Draw(Shader& shader)
     {
         for (unsigned int i = 0; i < meshes.size(); i++)
             meshes[i].Draw(shader);
     }
 
+    // same, skipping the meshlets outside the frustum or facing away from the camera.
+    // With a LOD selector distant meshes are drawn at a coarser level
+    void Draw(Shader& shader, const glm::mat4& viewProjection, const glm::mat4& model, const glm::vec3& cameraPosition, const LodSelector* lod = nullptr)
+    {
+        MeshletCulling culling = MeshletCulling::forModel(viewProjection, model, cameraPosition);
+        for (unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].Draw(shader, &culling, lod);
+    }
+
+    // only the positions, for passes that need nothing else. The shader is already in use
+    void DrawPositions(const glm::mat4& viewProjection, const glm::mat4& model, const glm::vec3& cameraPosition, const LodSelector* lod = nullptr)
+    {
+        MeshletCulling culling = MeshletCulling::forModel(viewProjection, model, cameraPosition);
+        for (unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].DrawPositions(&culling, lod);
+    }
+
 private:
-    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(string const& path)
+    // the GL half of loading: uploads the staged meshes into the arena and requests their textures from the TextureStreamer.
+    // A warm start uploads the meshes straight from the mapped cache file
+    void upload(StagedModel& staged)
     {
-        // read file via ASSIMP
-        Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
-        // check for errors
-        if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
-        {
-            cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
+        if (!staged.valid)
             return;
+        auto start = std::chrono::steady_clock::now();
+        const string& path = staged.path;
+        directory = staged.directory;
+
+        // meshes are moved into place and never copied
+        meshes.reserve(staged.meshes.size());
+        for (CookedMesh& mesh : staged.meshes)
+        {
+            vector<Texture> textures;
+            for (const Texture& texture : mesh.textures)
+                textures.push_back(loadTexture(texture));
+            meshes.emplace_back(std::move(mesh), std::move(textures), retention, *arena);
         }
-        // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
+        staged.meshes.clear();
+        staged.cacheFile.reset();
 
-        // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        size_t packedBytes = 0, fullBytes = 0, indexBytes = 0, positionBytes = 0;
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            if (i == 0)
+                bounds = meshes[i].bounds;
+            else
+                bounds.merge(meshes[i].bounds);
+        }
+        for (const Mesh& mesh : meshes)
+        {
+            packedBytes += mesh.vertexCount * mesh.format.stride();
+            fullBytes += mesh.vertexCount * sizeof(Vertex);
+            indexBytes += mesh.indexBufferSize();
+            if (mesh.positionVAO)
+                positionBytes += mesh.positionCount * sizeof(glm::vec3) + mesh.indexBufferSize();
+        }
+        cout << "STATS::STARTUP " << path << " vertex buffers: " << packedBytes / 1024 << " KB (full layout "
+            << fullBytes / 1024 << " KB), index buffers: " << indexBytes / 1024 << " KB, position streams: " << positionBytes / 1024 << " KB" << endl;
+        if (!staged.cached)
+            cout << "STATS::STARTUP " << path << " ACMR: " << staged.cacheBefore.acmr() << " -> " << staged.cacheAfter.acmr()
+                << ", ATVR: " << staged.cacheBefore.atvr() << " -> " << staged.cacheAfter.atvr() << endl;
+
+        vector<size_t> lodTriangles;
+        for (const Mesh& mesh : meshes)
+        {
+            lodTriangles.resize(std::max(lodTriangles.size(), mesh.lods.size()));
+            for (size_t level = 0; level < mesh.lods.size(); level++)
+                lodTriangles[level] += mesh.lods[level].indexCount / 3;
+        }
+        cout << "STATS::STARTUP " << path << " LOD triangles:";
+        for (size_t level = 0; level < lodTriangles.size(); level++)
+            cout << (level ? " / " : " ") << lodTriangles[level];
+        cout << endl;
+        cout << "STATS::STARTUP " << path << " staged in " << staged.stageMilliseconds << " ms, uploaded in "
+            << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms, mesh cache "
+            << (staged.cached ? "hit" : "miss") << endl;
     }
 
-    // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode* node, const aiScene* scene)
+    // lists the meshes of the node and its children depth first, the order their CookedMeshes are stored in
+    static void collectMeshes(aiNode* node, const aiScene* scene, vector<aiMesh*>& work)
     {
-        // process each mesh located at the current node
+        // the node object only contains indices to index the actual objects in the scene. 
+        // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
         for (unsigned int i = 0; i < node->mNumMeshes; i++)
-        {
-            // the node object only contains indices to index the actual objects in the scene. 
-            // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
-        }
-        // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
+            work.push_back(scene->mMeshes[node->mMeshes[i]]);
         for (unsigned int i = 0; i < node->mNumChildren; i++)
+            collectMeshes(node->mChildren[i], scene, work);
+    }
+
+    // converts every mesh of the scene in parallel, each into its own preallocated slot so the result
+    // doesn't depend on which thread finished first
+    static void processNode(aiNode* node, const aiScene* scene, StagedModel& staged)
+    {
+        vector<aiMesh*> work;
+        work.reserve(scene->mNumMeshes);
+        collectMeshes(node, scene, work);
+
+        staged.meshes.resize(work.size());
+        vector<MeshOptimizer::CacheStats> before(work.size()), after(work.size());
+        ThreadPool::global().parallelFor(work.size(), [&](size_t i) {
+            staged.meshes[i] = processMesh(work[i], scene, before[i], after[i]);
+        });
+        // summed in mesh order, floating point sums are order dependent
+        for (size_t i = 0; i < work.size(); i++)
         {
-            processNode(node->mChildren[i], scene);
+            staged.cacheBefore += before[i];
+            staged.cacheAfter += after[i];
         }
-
     }
 
-    Mesh processMesh(aiMesh* mesh, const aiScene* scene)
+    // safe to run for several meshes of a scene at once, it only reads the scene
+    static CookedMesh processMesh(aiMesh* mesh, const aiScene* scene, MeshOptimizer::CacheStats& before, MeshOptimizer::CacheStats& after)
     {
-        // data to fill
-        vector<Vertex> vertices;
+        // data to fill, the vertices zeroed since the optimizer welds them by comparing their bytes
+        vector<Vertex> vertices(mesh->mNumVertices, Vertex{});
         vector<unsigned int> indices;
         vector<Texture> textures;
 
-        // walk through each of the mesh's vertices
-        for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+        // walk through each of the mesh's vertices, filling every attribute in one pass over the 88 byte Vertex
+        static_assert(sizeof(aiVector3D) == sizeof(glm::vec3), "aiVector3D and glm::vec3 must match to be copied");
+        const unsigned int count = mesh->mNumVertices;
+        const bool hasNormals = mesh->HasNormals();
+        // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't 
+        // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
+        const aiVector3D* texCoords = mesh->mTextureCoords[0];
+        const bool hasTangents = texCoords && mesh->HasTangentsAndBitangents();
+        for (unsigned int i = 0; i < count; i++)
         {
-            Vertex vertex;
-            glm::vec3 vector; // we declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
-            // positions
-            vector.x = mesh->mVertices[i].x;
-            vector.y = mesh->mVertices[i].y;
-            vector.z = mesh->mVertices[i].z;
-            vertex.Position = vector;
-            // normals
-            if (mesh->HasNormals())
-            {
-                vector.x = mesh->mNormals[i].x;
-                vector.y = mesh->mNormals[i].y;
-                vector.z = mesh->mNormals[i].z;
-                vertex.Normal = vector;
-            }
-            // texture coordinates
-            if (mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
+            Vertex& vertex = vertices[i];
+            std::memcpy(&vertex.Position, &mesh->mVertices[i], sizeof(glm::vec3));
+            if (hasNormals)
+                std::memcpy(&vertex.Normal, &mesh->mNormals[i], sizeof(glm::vec3));
+            if (texCoords)
+                vertex.TexCoords = glm::vec2(texCoords[i].x, texCoords[i].y);
+            if (hasTangents)
             {
-                glm::vec2 vec;
-                // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't 
-                // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
-                vec.x = mesh->mTextureCoords[0][i].x;
-                vec.y = mesh->mTextureCoords[0][i].y;
-                vertex.TexCoords = vec;
-                // tangent
-                vector.x = mesh->mTangents[i].x;
-                vector.y = mesh->mTangents[i].y;
-                vector.z = mesh->mTangents[i].z;
-                vertex.Tangent = vector;
-                // bitangent
-                vector.x = mesh->mBitangents[i].x;
-                vector.y = mesh->mBitangents[i].y;
-                vector.z = mesh->mBitangents[i].z;
-                vertex.Bitangent = vector;
+                std::memcpy(&vertex.Tangent, &mesh->mTangents[i], sizeof(glm::vec3));
+                std::memcpy(&vertex.Bitangent, &mesh->mBitangents[i], sizeof(glm::vec3));
             }
-            else
-                vertex.TexCoords = glm::vec2(0.0f, 0.0f);
-
-            vertices.push_back(vertex);
         }
+
         // now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
+        size_t indexCount = 0;
+        for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+            indexCount += mesh->mFaces[i].mNumIndices;
+        indices.reserve(indexCount);
         for (unsigned int i = 0; i < mesh->mNumFaces; i++)
         {
-            aiFace face = mesh->mFaces[i];
+            const aiFace& face = mesh->mFaces[i];
             // retrieve all indices of the face and store them in the indices vector
             for (unsigned int j = 0; j < face.mNumIndices; j++)
                 indices.push_back(face.mIndices[j]);
         }
+        // weld the vertices assimp unrolled per face and reorder for the vertex cache, overdraw and fetch
+        MeshOptimizer::optimize(vertices, indices, before, after);
+        // coarser levels are appended to the indices, sharing the vertices
+        vector<MeshLod> lods;
+        indices = MeshSimplifier::buildLods(vertices, indices, lods);
+
         // process materials
         aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
         // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
@@ -139,93 +298,70 @@ private:
         // normal: texture_normalN
 
         // 1. diffuse maps
-        vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
+        vector<Texture> diffuseMaps = materialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
         textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
         // 2. specular maps
-        vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
+        vector<Texture> specularMaps = materialTextures(material, aiTextureType_SPECULAR, "texture_specular");
         textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
         // 3. normal maps
-        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
+        std::vector<Texture> normalMaps = materialTextures(material, aiTextureType_HEIGHT, "texture_normal");
         textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
         // 4. height maps
-        std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
+        std::vector<Texture> heightMaps = materialTextures(material, aiTextureType_AMBIENT, "texture_height");
         textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        // upload only what the mesh actually has, skinning attributes only for meshes with bones
+        VertexFormat format;
+        format.normals = mesh->HasNormals();
+        format.texCoords = mesh->HasTextureCoords(0);
+        format.tangents = mesh->HasTextureCoords(0) && mesh->HasTangentsAndBitangents();
+        format.skinned = mesh->HasBones();
+
+        // the mesh processed for the GPU, the textures are loaded when it is uploaded
+        CookedMesh cooked = CookedMesh::cook(std::move(vertices), std::move(indices), format, std::move(lods));
+        cooked.textures = std::move(textures);
+        return cooked;
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, string typeName)
+    // type and path of all material textures of a given type, loaded by loadTexture once the mesh is uploaded
+    static vector<Texture> materialTextures(aiMaterial* mat, aiTextureType type, string typeName)
     {
         vector<Texture> textures;
         for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for (unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if (!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecessary load duplicate textures.
-            }
+            textures.push_back({ 0, typeName, str.C_Str() });
         }
         return textures;
     }
-};
-
 
-unsigned int TextureFromFile(const char* path, const string& directory, bool gamma)
-{
-    string filename = string(path);
-    filename = directory + '/' + filename;
+    // takes the texture from the TextureCache. If no model loaded it yet it is streamed in, showing a neutral
+    // placeholder until then. The returned Texture has its id
+    Texture loadTexture(const Texture& reference)
+    {
+        // every mesh using the texture shares the model's one reference
+        auto loaded = loadedIndex.find(reference.path);
+        if (loaded != loadedIndex.end())
+            return textures_loaded[loaded->second];
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+        // grey for colors, a flat tangent space normal for normal maps
+        static const unsigned char greyPlaceholder[4] = { 128, 128, 128, 255 };
+        static const unsigned char normalPlaceholder[4] = { 128, 128, 255, 255 };
+        const unsigned char* placeholder = reference.type == "texture_normal" ? normalPlaceholder : greyPlaceholder;
 
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+        TextureSettings settings;
+        settings.minFilter = GL_LINEAR_MIPMAP_LINEAR;
+        string path = directory + '/' + reference.path;
+        Texture texture = reference;
+        texture.id = TextureCache::global().acquire(path, settings, [&](size_t& bytes) {
+            return TextureStreamer::global().load(path, settings, placeholder, bytes);
+        });
+        loadedIndex.emplace(reference.path, textures_loaded.size());
+        textures_loaded.push_back(texture);
+        return texture;
     }
 
-    return textureID;
-}
\ No newline at end of file
+    // path -> position in textures_loaded
+    unordered_map<string, size_t> loadedIndex;
+};
@@ -6,9 +6,10 @@ out VS_OUT {
     vec3 normal;
 } vs_out;
 
-uniform mat4 view;
 uniform mat4 model;
 
+#include "FrameData.glsl"
+
 void main()
 {
     gl_Position = view * model * vec4(aPos, 1.0); 
@@ -0,0 +1,190 @@
+#include "Primitives.h"
+#include "GLState.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+Primitives::~Primitives()
+{
+    if (VAO)
+        glDeleteVertexArrays(1, &VAO);
+    if (VBO)
+        glDeleteBuffers(1, &VBO);
+    if (EBO)
+        glDeleteBuffers(1, &EBO);
+}
+
+Primitives::Range Primitives::begin()
+{
+    shapeStart = vertices.size();
+    Range range;
+    range.firstIndex = static_cast<unsigned int>(indices.size());
+    range.baseVertex = static_cast<GLint>(shapeStart);
+    return range;
+}
+
+Primitives::Range Primitives::end(Range range)
+{
+    range.indexCount = static_cast<unsigned int>(indices.size() - range.firstIndex);
+    largestShape = std::max(largestShape, vertices.size() - shapeStart);
+    return range;
+}
+
+void Primitives::grid(const glm::vec3& origin, const glm::vec3& edgeU, const glm::vec3& edgeV, unsigned int segments, bool flip,
+    const glm::vec2& uvOrigin, const glm::vec2& uvU, const glm::vec2& uvV)
+{
+    segments = std::max(segments, 1u);
+    glm::vec3 normal = glm::normalize(glm::cross(edgeU, edgeV)) * (flip ? -1.0f : 1.0f);
+    // indices are relative to the shape, glDrawElementsBaseVertex adds the start
+    unsigned int first = static_cast<unsigned int>(vertices.size() - shapeStart);
+    for (unsigned int j = 0; j <= segments; j++)
+    {
+        for (unsigned int i = 0; i <= segments; i++)
+        {
+            float u = (float)i / segments;
+            float v = (float)j / segments;
+            vertices.push_back({ origin + edgeU * u + edgeV * v, normal, uvOrigin + uvU * u + uvV * v });
+        }
+    }
+    unsigned int row = segments + 1;
+    for (unsigned int j = 0; j < segments; j++)
+    {
+        for (unsigned int i = 0; i < segments; i++)
+        {
+            unsigned int a = first + j * row + i;
+            unsigned int b = a + 1;
+            unsigned int c = a + row + 1;
+            unsigned int d = a + row;
+            if (flip)
+                indices.insert(indices.end(), { a, c, b, a, d, c });
+            else
+                indices.insert(indices.end(), { a, b, c, a, c, d });
+        }
+    }
+}
+
+Primitives::Range Primitives::cube(float size, unsigned int segments, bool inward)
+{
+    // normal and two edges with edgeU x edgeV = normal, for each face
+    static const glm::vec3 faces[6][3] =
+    {
+        { glm::vec3(1, 0, 0),  glm::vec3(0, 0, -1), glm::vec3(0, 1, 0) },
+        { glm::vec3(-1, 0, 0), glm::vec3(0, 0, 1),  glm::vec3(0, 1, 0) },
+        { glm::vec3(0, 1, 0),  glm::vec3(1, 0, 0),  glm::vec3(0, 0, -1) },
+        { glm::vec3(0, -1, 0), glm::vec3(1, 0, 0),  glm::vec3(0, 0, 1) },
+        { glm::vec3(0, 0, 1),  glm::vec3(1, 0, 0),  glm::vec3(0, 1, 0) },
+        { glm::vec3(0, 0, -1), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0) },
+    };
+    Range range = begin();
+    float half = size * 0.5f;
+    for (const auto& face : faces)
+        grid((face[0] - face[1] - face[2]) * half, face[1] * size, face[2] * size, segments, inward);
+    return end(range);
+}
+
+Primitives::Range Primitives::sphere(float radius, unsigned int slices, unsigned int stacks)
+{
+    slices = std::max(slices, 3u);
+    stacks = std::max(stacks, 2u);
+    Range range = begin();
+    const float pi = 3.14159265358979f;
+    // the seam column is doubled so the uv can wrap, rows go from the top pole down
+    for (unsigned int j = 0; j <= stacks; j++)
+    {
+        float phi = pi * j / stacks;
+        for (unsigned int i = 0; i <= slices; i++)
+        {
+            float theta = 2.0f * pi * i / slices;
+            glm::vec3 normal(std::sin(phi) * std::sin(theta), std::cos(phi), std::sin(phi) * std::cos(theta));
+            vertices.push_back({ normal * radius, normal, glm::vec2((float)i / slices, 1.0f - (float)j / stacks) });
+        }
+    }
+    unsigned int row = slices + 1;
+    for (unsigned int j = 0; j < stacks; j++)
+    {
+        for (unsigned int i = 0; i < slices; i++)
+        {
+            unsigned int a = j * row + i;
+            unsigned int b = a + row;
+            unsigned int c = b + 1;
+            unsigned int d = a + 1;
+            // the triangle touching a pole with two of its corners is empty
+            if (j != stacks - 1)
+                indices.insert(indices.end(), { a, b, c });
+            if (j != 0)
+                indices.insert(indices.end(), { a, c, d });
+        }
+    }
+    return end(range);
+}
+
+Primitives::Range Primitives::plane(float size, unsigned int segments)
+{
+    Range range = begin();
+    float half = size * 0.5f;
+    grid(glm::vec3(-half, 0.0f, half), glm::vec3(size, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -size), segments, false);
+    return end(range);
+}
+
+Primitives::Range Primitives::quad(const glm::vec2& min, const glm::vec2& max, const glm::vec2& uvMin, const glm::vec2& uvMax)
+{
+    Range range = begin();
+    glm::vec2 uvSize = uvMax - uvMin;
+    grid(glm::vec3(min, 0.0f), glm::vec3(max.x - min.x, 0.0f, 0.0f), glm::vec3(0.0f, max.y - min.y, 0.0f), 1, false,
+        uvMin, glm::vec2(uvSize.x, 0.0f), glm::vec2(0.0f, uvSize.y));
+    return end(range);
+}
+
+Primitives::Range Primitives::fullscreenTriangle()
+{
+    Range range = begin();
+    glm::vec3 normal(0.0f, 0.0f, 1.0f);
+    vertices.push_back({ glm::vec3(-1.0f, -1.0f, 0.0f), normal, glm::vec2(0.0f, 0.0f) });
+    vertices.push_back({ glm::vec3(3.0f, -1.0f, 0.0f), normal, glm::vec2(2.0f, 0.0f) });
+    vertices.push_back({ glm::vec3(-1.0f, 3.0f, 0.0f), normal, glm::vec2(0.0f, 2.0f) });
+    indices.insert(indices.end(), { 0u, 1u, 2u });
+    return end(range);
+}
+
+void Primitives::upload()
+{
+    static_assert(sizeof(PrimitiveVertex) == Layout::stride, "PrimitiveVertex doesn't match Primitives::Layout");
+    if (VAO)
+    {
+        std::cout << "ERROR::PRIMITIVES:: already uploaded" << std::endl;
+        return;
+    }
+
+    glGenVertexArrays(1, &VAO);
+    glBindVertexArray(VAO);
+    VBO = Layout::createBuffer(vertices.data(), vertices.size() * sizeof(PrimitiveVertex));
+
+    glGenBuffers(1, &EBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    if (largestShape <= 65536)
+    {
+        indexType = GL_UNSIGNED_SHORT;
+        std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(uint16_t), shortIndices.data(), GL_STATIC_DRAW);
+    }
+    else
+    {
+        indexType = GL_UNSIGNED_INT;
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    }
+    glBindVertexArray(0);
+
+    uploadedVertices = vertices.size();
+    uploadedIndices = indices.size();
+    std::vector<PrimitiveVertex>().swap(vertices);
+    std::vector<unsigned int>().swap(indices);
+}
+
+void Primitives::draw(const Range& range) const
+{
+    size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+    GLState::bindVertexArray(VAO);
+    glDrawElementsBaseVertex(GL_TRIANGLES, range.indexCount, indexType, (void*)(range.firstIndex * indexSize), range.baseVertex);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+#include "VertexLayout.h"
+
+// Built-in shapes generated as indexed triangles into one vertex and one index buffer shared by all of them.
+// Each shape returns its Range and is drawn with glDrawElementsBaseVertex, every shape from the same VAO.
+// Vertices are position, normal and uv on locations 0-2, shaders that read less just don't declare the rest.
+// Shapes take a tessellation so benchmark scenes can scale the vertex work
+class Primitives
+{
+public:
+    typedef VertexLayout<Pos3f, Normal3f, UV2f> Layout;
+
+    struct PrimitiveVertex
+    {
+        glm::vec3 position;
+        glm::vec3 normal;
+        glm::vec2 uv;
+    };
+
+    // where a shape is in the shared buffers, indices count from baseVertex
+    struct Range
+    {
+        unsigned int firstIndex = 0;
+        unsigned int indexCount = 0;
+        GLint baseVertex = 0;
+    };
+
+    Primitives() = default;
+    ~Primitives();
+    Primitives(const Primitives&) = delete;
+    Primitives& operator=(const Primitives&) = delete;
+
+    // cube centered on the origin, each face a segments x segments grid.
+    // inward turns the faces and normals to the inside, for drawing it from within like a skybox
+    Range cube(float size = 1.0f, unsigned int segments = 1, bool inward = false);
+    // sphere centered on the origin, u around the y axis and v from the bottom to the top pole
+    Range sphere(float radius = 0.5f, unsigned int slices = 32, unsigned int stacks = 16);
+    // square in the xz plane facing +y
+    Range plane(float size = 1.0f, unsigned int segments = 1);
+    // rectangle in the xy plane facing +z, uvMin at the min corner and uvMax at the max corner
+    Range quad(const glm::vec2& min, const glm::vec2& max, const glm::vec2& uvMin = glm::vec2(0.0f), const glm::vec2& uvMax = glm::vec2(1.0f));
+    // one triangle over all of clip space, uv 0..1 across the screen. Cheaper than a quad, no diagonal seam
+    Range fullscreenTriangle();
+
+    // copies every shape added so far to the GPU, in the vertexStreams arrangement. Shapes can't be added afterwards
+    void upload();
+    // binds the shared VAO (through GLState) and draws the shape
+    void draw(const Range& range) const;
+
+    unsigned int vertexArray() const { return VAO; }
+    size_t vertexCount() const { return uploadedVertices; }
+    size_t indexCount() const { return uploadedIndices; }
+
+private:
+    std::vector<PrimitiveVertex> vertices;
+    std::vector<unsigned int> indices;
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    // GL_UNSIGNED_SHORT when no shape has more vertices than 16 bits address
+    GLenum indexType = GL_UNSIGNED_INT;
+    size_t uploadedVertices = 0, uploadedIndices = 0;
+    // first vertex of the shape being built
+    size_t shapeStart = 0;
+    // largest vertex count of one shape, decides the index type
+    size_t largestShape = 0;
+
+    Range begin();
+    Range end(Range range);
+    // a (segments + 1)^2 vertex grid spanning origin + edgeU * [0, 1] + edgeV * [0, 1], front facing towards edgeU x edgeV
+    // unless flipped. The uv goes from uvOrigin by uvU and uvV along the edges
+    void grid(const glm::vec3& origin, const glm::vec3& edgeU, const glm::vec3& edgeV, unsigned int segments, bool flip,
+        const glm::vec2& uvOrigin = glm::vec2(0.0f), const glm::vec2& uvU = glm::vec2(1.0f, 0.0f), const glm::vec2& uvV = glm::vec2(0.0f, 1.0f));
+};
@@ -4,13 +4,14 @@ out vec4 FragColor;
 in vec3 Normal;
 in vec3 Position;
 
-uniform vec3 cameraPos;
 uniform samplerCube skybox;
 
+#include "FrameData.glsl"
+
 void main()
 {             
     float ratio = 1.00 / 1.52;
-    vec3 I = normalize(Position - cameraPos);
+    vec3 I = normalize(Position - cameraPos.xyz);
     vec3 R = refract(I, normalize(Normal), ratio);
     FragColor = vec4(texture(skybox, R).rgb, 1.0);
 }
\ No newline at end of file
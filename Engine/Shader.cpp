@@ -1,147 +1,628 @@
 #include "Shader.h"
+#include "GLState.h"
+#include "ShaderCache.h"
+#include "ShaderUniforms.h"
+
+#include <algorithm>
+#include <cstring>
 
 #include <glm/glm/glm.hpp>
 #include <glm/glm/gtc/matrix_transform.hpp>
 #include <glm/glm/gtc/type_ptr.hpp>
-unsigned int ID;
 
-void checkShaderErrorAndPrint(unsigned int shader, bool isShader = true);
+ShaderStats Shader::stats;
+unsigned int Shader::sharedPermutations = 0;
+std::unordered_map<std::string, std::weak_ptr<ShaderProgram>> Shader::permutations;
+bool Shader::batching = false;
+std::vector<std::weak_ptr<ShaderProgram>> Shader::pending;
+std::vector<std::weak_ptr<ShaderProgram>> Shader::reloading;
+
+bool checkShaderErrorAndPrint(unsigned int shader, bool isShader = true);
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath, const ShaderDefines& defines)
+{
+    build(vertexPath, fragmentPath, geometryPath, defines, nullptr);
+}
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath)
+Shader::Shader(const ProgramReflection& reflection, const ShaderDefines& defines)
 {
-    // 1. retrieve the vertex/fragment source code from filePath
-    std::string vertexCode;
-    std::string fragmentCode;
+    build(reflection.vertexPath, reflection.fragmentPath, reflection.geometryPath, defines, &reflection);
+}
+
+void Shader::build(const char* vertexPath, const char* fragmentPath, const char* geometryPath, const ShaderDefines& defines, const ProgramReflection* reflection)
+{
+    // 1. retrieve the vertex/fragment source code from filePath, includes resolved and defines injected
+    std::vector<std::string> dependencies;
+    std::string vertexCode = ShaderSource::load(vertexPath, defines, dependencies);
+    std::string fragmentCode = ShaderSource::load(fragmentPath, defines, dependencies);
     std::string geometryCode;
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
-    std::ifstream gShaderFile;
-    // ensure ifstream objects can throw exceptions:
-    vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    gShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    try
-    {
-        // open files
-        vShaderFile.open(vertexPath);
-        fShaderFile.open(fragmentPath);
-        std::stringstream vShaderStream, fShaderStream;
-        // read file's buffer contents into streams
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
-        // close file handlers
-        vShaderFile.close();
-        fShaderFile.close();
-        // convert stream into string
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
-
-        if (geometryPath)
+    if (geometryPath)
+        geometryCode = ShaderSource::load(geometryPath, defines, dependencies);
+
+    // this permutation was built already, share it
+    std::string permutationKey = vertexCode + '\0' + fragmentCode + '\0' + geometryCode;
+    std::weak_ptr<ShaderProgram>& permutation = permutations[permutationKey];
+    program = permutation.lock();
+    if (program)
+    {
+        sharedPermutations++;
+        return;
+    }
+    program = std::make_shared<ShaderProgram>();
+    program->vertexPath = vertexPath;
+    program->fragmentPath = fragmentPath;
+    program->geometryPath = geometryPath ? geometryPath : "";
+    program->defines = defines;
+    program->reflection = reflection;
+    program->dependencies = dependencies;
+    program->permutationKey = permutationKey;
+    permutation = program;
+
+    // 2. reuse the binary linked on a previous run when the driver still accepts it
+    program->ID = glCreateProgram();
+    bool binaryCache = ProgramBinaryCache::available();
+    uint64_t cacheKey = 0;
+    if (binaryCache)
+        cacheKey = ProgramBinaryCache::makeKey({ vertexCode, fragmentCode, geometryCode });
+    if (!binaryCache || !ProgramBinaryCache::load(program->ID, cacheKey))
+    {
+        // 3. otherwise compile from source and remember the result for the next run
+        program->submit(vertexCode, fragmentCode, geometryPath ? &geometryCode : nullptr, binaryCache);
+        program->binaryKey = cacheKey;
+        if (batching)
         {
-            gShaderFile.open(geometryPath);
-            std::stringstream gShaderStream;
-            gShaderStream << gShaderFile.rdbuf();
-            gShaderFile.close();
-            geometryCode = gShaderStream.str();
+            pending.push_back(program);
+            return;
         }
     }
-    catch (std::ifstream::failure e)
+    program->finish();
+}
+
+void Shader::beginBatch()
+{
+    batching = true;
+    // let the driver use as many compiler threads as it likes
+    if (GLAD_GL_KHR_parallel_shader_compile)
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+}
+
+void Shader::endBatch()
+{
+    batching = false;
+}
+
+void Shader::pollPending()
+{
+    for (size_t i = 0; i < reloading.size();)
     {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+        std::shared_ptr<ShaderProgram> program = reloading[i].lock();
+        if (program && !pollReload(*program))
+        {
+            i++;
+            continue;
+        }
+        reloading[i] = reloading.back();
+        reloading.pop_back();
     }
-    const char* vShaderCode = vertexCode.c_str();
-    const char* fShaderCode = fragmentCode.c_str();
 
-    unsigned int vertex, fragment;
+    for (size_t i = 0; i < pending.size();)
+    {
+        std::shared_ptr<ShaderProgram> program = pending[i].lock();
+        if (program && !program->ready && !program->linkCompleted())
+        {
+            i++;
+            continue;
+        }
+        if (program && !program->ready)
+            program->finish();
+        pending[i] = pending.back();
+        pending.pop_back();
+    }
+}
 
-    // vertex Shader
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
-    glCompileShader(vertex);
-    checkShaderErrorAndPrint(vertex);
+std::vector<ProgramUniformStats> Shader::takeUniformStats()
+{
+    std::vector<ProgramUniformStats> result;
+    for (const auto& permutation : permutations)
+    {
+        std::shared_ptr<ShaderProgram> program = permutation.second.lock();
+        if (!program || (!program->uniformsUploaded && !program->uniformsSkipped))
+            continue;
+        result.push_back({ program->label(), program->uniformsUploaded, program->uniformsSkipped });
+        program->uniformsUploaded = 0;
+        program->uniformsSkipped = 0;
+    }
+    return result;
+}
 
-    // fragment Shader
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
-    checkShaderErrorAndPrint(fragment);
+unsigned int Shader::pendingCount()
+{
+    unsigned int count = 0;
+    for (const std::weak_ptr<ShaderProgram>& weak : pending)
+    {
+        std::shared_ptr<ShaderProgram> program = weak.lock();
+        if (program && !program->ready)
+            count++;
+    }
+    return count;
+}
 
-    // shader Program
-    ID = glCreateProgram();
-    glAttachShader(ID, vertex);
-    glAttachShader(ID, fragment);
-    if (geometryPath)
+std::vector<std::string> Shader::sourceFiles()
+{
+    std::vector<std::string> files;
+    for (const auto& permutation : permutations)
     {
-        const char* gShaderCode = geometryCode.c_str();
-        unsigned int geometry;
-        geometry = glCreateShader(GL_GEOMETRY_SHADER);
-        glShaderSource(geometry, 1, &gShaderCode, NULL);
-        glCompileShader(geometry);
-        checkShaderErrorAndPrint(geometry);
-        glAttachShader(ID, geometry);
+        std::shared_ptr<ShaderProgram> program = permutation.second.lock();
+        if (!program)
+            continue;
+        for (const std::string& file : program->dependencies)
+            if (std::find(files.begin(), files.end(), file) == files.end())
+                files.push_back(file);
     }
-    glLinkProgram(ID);
-    checkShaderErrorAndPrint(ID, false);
+    return files;
+}
+
+void Shader::reloadChanged(const std::vector<std::string>& files)
+{
+    if (files.empty())
+        return;
+    for (const auto& permutation : permutations)
+    {
+        std::shared_ptr<ShaderProgram> program = permutation.second.lock();
+        if (!program)
+            continue;
+        bool changed = false;
+        for (const std::string& file : files)
+            changed = changed || std::find(program->dependencies.begin(), program->dependencies.end(), file) != program->dependencies.end();
+        if (!changed)
+            continue;
+
+        // a newer edit supersedes a rebuild still compiling
+        if (!program->replacement)
+            reloading.push_back(program);
+        program->reloadStart = std::chrono::steady_clock::now();
+        std::shared_ptr<ShaderProgram> rebuilt = std::make_shared<ShaderProgram>();
+        std::string vertexCode = ShaderSource::load(program->vertexPath, program->defines, rebuilt->dependencies);
+        std::string fragmentCode = ShaderSource::load(program->fragmentPath, program->defines, rebuilt->dependencies);
+        std::string geometryCode;
+        if (!program->geometryPath.empty())
+            geometryCode = ShaderSource::load(program->geometryPath, program->defines, rebuilt->dependencies);
+
+        bool binaryCache = ProgramBinaryCache::available();
+        rebuilt->ID = glCreateProgram();
+        rebuilt->submit(vertexCode, fragmentCode, program->geometryPath.empty() ? nullptr : &geometryCode, binaryCache);
+        rebuilt->permutationKey = vertexCode + '\0' + fragmentCode + '\0' + geometryCode;
+        if (binaryCache)
+            rebuilt->binaryKey = ProgramBinaryCache::makeKey({ vertexCode, fragmentCode, geometryCode });
+        program->replacement = rebuilt;
+    }
+}
+
+bool Shader::pollReload(ShaderProgram& program)
+{
+    if (!program.replacement)
+        return true;
+    if (!program.replacement->linkCompleted())
+        return false;
+
+    std::shared_ptr<ShaderProgram> rebuilt = program.replacement;
+    program.replacement.reset();
+    rebuilt->finish();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - program.reloadStart).count();
+    if (!rebuilt->linked)
+    {
+        std::cout << "ERROR::SHADER::RELOAD_FAILED " << program.fragmentPath << ", keeping the previous program" << std::endl;
+        return true;
+    }
+    // the original has to be finished too, its uniform values are copied over
+    program.finish();
+    program.adopt(*rebuilt);
+    // shared from now on under the edited sources, a Shader built from them later gets this program.
+    // The entry is moved rather than rebuilt, it only holds a weak reference to the program
+    auto entry = permutations.find(program.permutationKey);
+    if (entry != permutations.end() && rebuilt->permutationKey != program.permutationKey)
+    {
+        std::weak_ptr<ShaderProgram> shared = entry->second;
+        permutations.erase(entry);
+        std::weak_ptr<ShaderProgram>& rekeyed = permutations[rebuilt->permutationKey];
+        if (rekeyed.expired())
+            rekeyed = shared;
+    }
+    program.permutationKey = rebuilt->permutationKey;
+    std::cout << "INFO::SHADER::RELOADED " << program.vertexPath << " + " << program.fragmentPath << " in " << ms << " ms" << std::endl;
+    return true;
+}
 
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+bool Shader::isReady() const
+{
+    if (program->ready)
+        return true;
+    if (!program->linkCompleted())
+        return false;
+    program->finish();
+    return true;
+}
+
+void Shader::waitReady() const
+{
+    if (!program->ready)
+        program->finish();
 }
 
 void Shader::use()
 {
-    glUseProgram(ID);
+    waitReady();
+    GLState::useProgram(program->ID);
+}
+
+UniformHandle Shader::getUniform(const std::string& name) const
+{
+    waitReady();
+    UniformHandle uniform;
+    auto it = program->uniformSlots.find(name);
+    if (it != program->uniformSlots.end())
+        uniform.slot = it->second;
+    return uniform;
 }
 
 void Shader::setBool(const std::string& name, bool value) const
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    setBool(getUniform(name), value);
 }
 void Shader::setInt(const std::string& name, int value) const
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    setInt(getUniform(name), value);
 }
 void Shader::setFloat(const std::string& name, float value) const
 {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    setFloat(getUniform(name), value);
 }
 
 void Shader::setMat4(const std::string& name, glm::mat4 value) const
 {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+    setMat4(getUniform(name), value);
 }
 
 void Shader::setMat3(const std::string& name, glm::mat3 value) const
 {
-    glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+    setMat3(getUniform(name), value);
 }
 
 void Shader::setVec3(const std::string& name, float x, float y, float z) const
 {
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+    setVec3(getUniform(name), x, y, z);
 }
 
 void Shader::setVec3(const std::string& name, glm::vec3 vec) const
 {
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), vec.x, vec.y, vec.z);
+    setVec3(getUniform(name), vec);
 }
 
 void Shader::setVec2(const std::string& name, glm::vec2 vec) const
 {
-    glUniform2f(glGetUniformLocation(ID, name.c_str()), vec.x, vec.y);
+    setVec2(getUniform(name), vec);
 }
 
-Shader::~Shader()
+void Shader::setBool(UniformHandle uniform, bool value) const
 {
+    int intValue = value;
+    GLint location = locationOf(uniform, GL_BOOL, &intValue, sizeof(intValue));
+    if (location != -1)
+        glUniform1i(location, intValue);
+}
+void Shader::setInt(UniformHandle uniform, int value) const
+{
+    GLint location = locationOf(uniform, GL_INT, &value, sizeof(value));
+    if (location != -1)
+        glUniform1i(location, value);
+}
+void Shader::setFloat(UniformHandle uniform, float value) const
+{
+    GLint location = locationOf(uniform, GL_FLOAT, &value, sizeof(value));
+    if (location != -1)
+        glUniform1f(location, value);
+}
+
+void Shader::setMat4(UniformHandle uniform, const glm::mat4& value) const
+{
+    GLint location = locationOf(uniform, GL_FLOAT_MAT4, glm::value_ptr(value), sizeof(value));
+    if (location != -1)
+        glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void Shader::setMat3(UniformHandle uniform, const glm::mat3& value) const
+{
+    GLint location = locationOf(uniform, GL_FLOAT_MAT3, glm::value_ptr(value), sizeof(value));
+    if (location != -1)
+        glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void Shader::setVec3(UniformHandle uniform, float x, float y, float z) const
+{
+    setVec3(uniform, glm::vec3(x, y, z));
+}
+
+void Shader::setVec3(UniformHandle uniform, const glm::vec3& vec) const
+{
+    GLint location = locationOf(uniform, GL_FLOAT_VEC3, glm::value_ptr(vec), sizeof(vec));
+    if (location != -1)
+        glUniform3f(location, vec.x, vec.y, vec.z);
+}
+
+void Shader::setVec2(UniformHandle uniform, const glm::vec2& vec) const
+{
+    GLint location = locationOf(uniform, GL_FLOAT_VEC2, glm::value_ptr(vec), sizeof(vec));
+    if (location != -1)
+        glUniform2f(location, vec.x, vec.y);
+}
+
+bool ShaderProgram::linkCompleted() const
+{
+    if (ready)
+        return true;
+    // without the extension there is no way to ask, finish() will have to wait
+    if (!GLAD_GL_KHR_parallel_shader_compile)
+        return true;
+    int completed = GL_FALSE;
+    glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &completed);
+    return completed == GL_TRUE;
+}
+
+void ShaderProgram::finish()
+{
+    if (ready)
+        return;
+    ready = true;
+
+    // the first query on a stage or the program waits for the driver
+    bool compiled = true;
+    for (unsigned int stage : stages)
+        compiled = checkShaderErrorAndPrint(stage) && compiled;
+    linked = (stages.empty() || checkShaderErrorAndPrint(ID, false)) && compiled;
+    for (unsigned int stage : stages)
+        glDeleteShader(stage);
+    stages.clear();
+    if (linked && binaryKey)
+        ProgramBinaryCache::store(ID, binaryKey);
+
+    // shared uniform blocks (camera state, lights) get the binding point ShaderReflect assigned them
+    for (const UniformBlockBinding& block : ShaderUniforms::uniformBlocks)
+    {
+        unsigned int blockIndex = glGetUniformBlockIndex(ID, block.name);
+        if (blockIndex != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, blockIndex, block.binding);
+    }
+
+    cacheUniforms();
+}
+
+void ShaderProgram::submit(const std::string& vertexCode, const std::string& fragmentCode, const std::string* geometryCode, bool retrievable)
+{
+    const char* vShaderCode = vertexCode.c_str();
+    const char* fShaderCode = fragmentCode.c_str();
+
+    // vertex Shader
+    unsigned int vertex = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertex, 1, &vShaderCode, NULL);
+    glCompileShader(vertex);
+    stages.push_back(vertex);
+
+    // fragment Shader
+    unsigned int fragment = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragment, 1, &fShaderCode, NULL);
+    glCompileShader(fragment);
+    stages.push_back(fragment);
+
+    if (geometryCode)
+    {
+        const char* gShaderCode = geometryCode->c_str();
+        unsigned int geometry = glCreateShader(GL_GEOMETRY_SHADER);
+        glShaderSource(geometry, 1, &gShaderCode, NULL);
+        glCompileShader(geometry);
+        stages.push_back(geometry);
+    }
+
+    // shader Program. Linking straight away is fine, a failed stage just fails the link
+    for (unsigned int stage : stages)
+        glAttachShader(ID, stage);
+    if (retrievable)
+        glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(ID);
+}
+
+// copies the current value of a uniform of the bound program "from" into the same uniform of the program in use
+static void copyUniform(unsigned int from, GLint fromLocation, GLint toLocation, GLenum type)
+{
+    float f[16];
+    int i = 0;
+    switch (type)
+    {
+    case GL_FLOAT: glGetUniformfv(from, fromLocation, f); glUniform1fv(toLocation, 1, f); break;
+    case GL_FLOAT_VEC2: glGetUniformfv(from, fromLocation, f); glUniform2fv(toLocation, 1, f); break;
+    case GL_FLOAT_VEC3: glGetUniformfv(from, fromLocation, f); glUniform3fv(toLocation, 1, f); break;
+    case GL_FLOAT_VEC4: glGetUniformfv(from, fromLocation, f); glUniform4fv(toLocation, 1, f); break;
+    case GL_FLOAT_MAT3: glGetUniformfv(from, fromLocation, f); glUniformMatrix3fv(toLocation, 1, GL_FALSE, f); break;
+    case GL_FLOAT_MAT4: glGetUniformfv(from, fromLocation, f); glUniformMatrix4fv(toLocation, 1, GL_FALSE, f); break;
+    case GL_INT:
+    case GL_BOOL:
+    case GL_SAMPLER_2D:
+    case GL_SAMPLER_CUBE: glGetUniformiv(from, fromLocation, &i); glUniform1i(toLocation, i); break;
+    default: break;
+    }
+}
+
+void ShaderProgram::adopt(ShaderProgram& rebuilt)
+{
+    // glUniform* only reaches the program in use, restore whatever was bound afterwards
+    GLint current = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+    GLState::useProgram(rebuilt.ID);
+
+    // keep the old slots, a uniform the new program dropped just gets location -1
+    for (UniformInfo& info : uniforms)
+    {
+        auto it = rebuilt.uniformSlots.find(info.name);
+        if (it == rebuilt.uniformSlots.end())
+        {
+            info.location = -1;
+            continue;
+        }
+        const UniformInfo& fresh = rebuilt.uniforms[it->second];
+        if (info.location != -1 && fresh.type == info.type)
+            copyUniform(ID, info.location, fresh.location, info.type);
+        else
+            info.shadowValid = false;
+        info.location = fresh.location;
+        info.type = fresh.type;
+    }
+    for (const UniformInfo& fresh : rebuilt.uniforms)
+        if (uniformSlots.find(fresh.name) == uniformSlots.end())
+            addUniform(fresh.name, fresh.location, fresh.type);
+
+    // the rebuild deletes the old program when it goes away
+    unsigned int oldID = ID;
+    ID = rebuilt.ID;
+    rebuilt.ID = oldID;
+    dependencies = rebuilt.dependencies;
+    GLState::useProgram(static_cast<unsigned int>(current) == oldID ? ID : current);
+}
+
+std::string ShaderProgram::label() const
+{
+    std::string label = reflection ? reflection->name : vertexPath + " + " + fragmentPath;
+    for (const auto& define : defines)
+        label += " " + define.first;
+    return label;
+}
+
+ShaderProgram::~ShaderProgram()
+{
+    for (unsigned int stage : stages)
+        glDeleteShader(stage);
     glDeleteProgram(ID);
 }
 
-void checkShaderErrorAndPrint(unsigned int shader, bool isShader)
+void ShaderProgram::cacheUniforms()
+{
+    uniforms.clear();
+    uniformSlots.clear();
+    // reflected uniforms take the slots their generated Uniform<T> was given, optimized out ones stay at -1
+    if (reflection)
+        for (unsigned int i = 0; i < reflection->uniformCount; i++)
+            addUniform(reflection->uniformNames[i], -1, GL_NONE);
+
+    int count = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    char name[256];
+    for (int i = 0; i < count; i++)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(ID, i, sizeof(name), &length, &size, &type, name);
+        // uniforms living in a uniform block have no location
+        GLint location = glGetUniformLocation(ID, name);
+        if (location == -1)
+            continue;
+        std::string uniformName(name, length);
+        // arrays are reported as "name[0]", register the bare name and every element
+        auto bracket = uniformName.find('[');
+        if (bracket != std::string::npos && uniformName.compare(bracket, std::string::npos, "[0]") == 0)
+        {
+            std::string base = uniformName.substr(0, bracket);
+            addUniform(base, location, type);
+            for (int element = 0; element < size; element++)
+            {
+                std::string elementName = base + "[" + std::to_string(element) + "]";
+                addUniform(elementName, glGetUniformLocation(ID, elementName.c_str()), type);
+            }
+        }
+        else
+            addUniform(uniformName, location, type);
+    }
+}
+
+void ShaderProgram::addUniform(const std::string& name, GLint location, GLenum type)
+{
+    auto it = uniformSlots.find(name);
+    if (it != uniformSlots.end())
+    {
+        uniforms[it->second].location = location;
+        uniforms[it->second].type = type;
+        return;
+    }
+    uniformSlots[name] = static_cast<int>(uniforms.size());
+    UniformInfo info;
+    info.name = name;
+    info.location = location;
+    info.type = type;
+    uniforms.push_back(info);
+}
+
+UniformHandle Shader::handleOf(const ProgramReflection* reflection, int slot) const
+{
+    waitReady();
+#ifdef _DEBUG
+    if (reflection != program->reflection)
+    {
+        std::cout << "ERROR::SHADER::UNIFORM_OF_ANOTHER_PROGRAM " << reflection->uniformNames[slot] << std::endl;
+        return UniformHandle();
+    }
+#else
+    (void)reflection;
+#endif
+    UniformHandle uniform;
+    uniform.slot = slot;
+    return uniform;
+}
+
+GLint Shader::locationOf(UniformHandle uniform, GLenum type, const void* value, size_t size) const
+{
+    if (!uniform.valid())
+        return -1;
+    stats.lookupsAvoided++;
+    ShaderProgram::UniformInfo& info = program->uniforms[uniform.slot];
+    if (info.location == -1)
+        return -1;
+#ifdef _DEBUG
+    // ints are also used for bools and sampler units
+    bool matches = info.type == type || ((type == GL_INT || type == GL_BOOL) &&
+        (info.type == GL_INT || info.type == GL_BOOL || info.type == GL_SAMPLER_2D || info.type == GL_SAMPLER_CUBE));
+    if (!matches)
+        std::cout << "ERROR::SHADER::UNIFORM_TYPE_MISMATCH " << info.name << std::endl;
+#else
+    (void)type;
+#endif
+    // glUniform goes to whatever program is bound. The shadow only describes this program if that is it
+    if (!GLState::cache.program.known || GLState::cache.program.value != program->ID)
+    {
+#ifdef _DEBUG
+        if (GLState::cache.program.known)
+            std::cout << "ERROR::SHADER::PROGRAM_NOT_BOUND " << info.name << std::endl;
+#endif
+        info.shadowValid = false;
+        program->uniformsUploaded++;
+        return info.location;
+    }
+    // the program still holds this value, uploading it again would change nothing
+    if (info.shadowValid && std::memcmp(info.shadow, value, size) == 0)
+    {
+        program->uniformsSkipped++;
+        return -1;
+    }
+    std::memcpy(info.shadow, value, size);
+    info.shadowValid = true;
+    program->uniformsUploaded++;
+    return info.location;
+}
+
+bool checkShaderErrorAndPrint(unsigned int shader, bool isShader)
 {
     int  success;
     char infoLog[512];
     isShader?
         glGetShaderiv(shader, GL_COMPILE_STATUS, &success) :
-        glGetProgramiv(ID, GL_LINK_STATUS, &success);
+        glGetProgramiv(shader, GL_LINK_STATUS, &success);
     if (!success)
     {
         isShader ?
@@ -151,5 +632,6 @@ void checkShaderErrorAndPrint(unsigned int shader, bool isShader)
             std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl:
             std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
     }
+    return success;
 }
 
@@ -4,22 +4,168 @@
 #include <glm/glm/glm.hpp>
 
 
+#include <chrono>
+#include <cstdint>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <memory>
+#include <vector>
+#include <unordered_map>
 
+#include "ShaderSource.h"
+
+
+// handle to an active uniform of a program, resolved once at link time.
+// Hot paths fetch it once and pass it to the set* overloads to skip the name lookup entirely
+struct UniformHandle
+{
+    int slot = -1;
+
+    bool valid() const { return slot >= 0; }
+};
+
+// what ShaderReflect generated for a program listed in ShaderPrograms.txt (see ShaderUniforms.h)
+struct ProgramReflection
+{
+    const char* name;
+    const char* vertexPath;
+    const char* fragmentPath;
+    const char* geometryPath;
+    // default block uniforms, a Uniform<T> of the program indexes into it
+    const char* const* uniformNames;
+    unsigned int uniformCount;
+};
+
+// default block uniform of a reflected program. The slot is fixed at build time,
+// so setting it costs no lookup and a value of the wrong type doesn't compile
+template <typename T>
+struct Uniform
+{
+    const ProgramReflection* program;
+    int slot;
+};
+
+// uniform block and the binding point it gets in every program declaring it
+struct UniformBlockBinding
+{
+    const char* name;
+    unsigned int binding;
+};
+
+// uniform uploads of one program
+struct ProgramUniformStats
+{
+    std::string program;
+    unsigned int uploaded;
+    unsigned int skipped;
+};
+
+// counters shared by all shaders, reset once per frame
+struct ShaderStats
+{
+    // glGetUniformLocation calls that a set* would have issued and got from the cache instead
+    unsigned int lookupsAvoided = 0;
+};
+
+// a linked program with its uniform table. Shared by every Shader built from the same sources and defines
+struct ShaderProgram
+{
+    struct UniformInfo
+    {
+        std::string name;
+        GLint location;
+        GLenum type;
+        // last value uploaded, a set* with the same bytes is skipped
+        float shadow[16];
+        bool shadowValid = false;
+    };
+
+    unsigned int ID = 0;
+    // linked, checked and uniforms cached
+    bool ready = false;
+    // compiled and linked without errors, known once ready
+    bool linked = false;
+    // active uniforms of the linked program, UniformHandle::slot indexes into it
+    std::vector<UniformInfo> uniforms;
+    std::unordered_map<std::string, int> uniformSlots;
+    // what the program is built from, kept to rebuild it when a file changes
+    std::string vertexPath, fragmentPath, geometryPath;
+    ShaderDefines defines;
+    // the first uniformCount slots are the reflected uniforms in order, null if built from plain paths
+    const ProgramReflection* reflection = nullptr;
+    // every file the stages were built from, included ones too, each once
+    std::vector<std::string> dependencies;
+    // preprocessed sources the program is shared under in Shader::permutations
+    std::string permutationKey;
+    // stages submitted to the driver, checked and deleted by finish()
+    std::vector<unsigned int> stages;
+    // set* calls that reached GL and that were skipped as unchanged, since the last Shader::takeUniformStats()
+    unsigned int uniformsUploaded = 0;
+    unsigned int uniformsSkipped = 0;
+    // binary cache entry to write once linked, 0 when there is nothing to store
+    uint64_t binaryKey = 0;
+    // rebuild compiling in the background after a dependency changed
+    std::shared_ptr<ShaderProgram> replacement;
+    std::chrono::steady_clock::time_point reloadStart;
+
+    // hands the stages to the driver and links without querying any result
+    void submit(const std::string& vertexCode, const std::string& fragmentCode, const std::string* geometryCode, bool retrievable);
+    // true when finish() would not have to wait for the driver
+    bool linkCompleted() const;
+    // checks the compile and link results and caches the uniforms, blocks until the driver is done
+    void finish();
+    // takes over the ID of a finished rebuild. Slots keep their names so existing UniformHandles stay valid,
+    // and the values set on the old program are copied over
+    void adopt(ShaderProgram& rebuilt);
+
+    // reflected name or stage paths, followed by the defines of the permutation
+    std::string label() const;
+
+    ~ShaderProgram();
+
+private:
+    // enumerates the active uniforms of the linked program
+    void cacheUniforms();
+    void addUniform(const std::string& name, GLint location, GLenum type);
+};
 
 class Shader
 {
 public:
-    // the program ID
-    unsigned int ID;
+    static ShaderStats stats;
+    // how many Shaders reused an already built permutation instead of compiling their own
+    static unsigned int sharedPermutations;
 
-    // constructor reads and builds the shader
-    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr);
+    // constructor reads and builds the shader, or picks up the program already built from the same sources and defines
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, const ShaderDefines& defines = ShaderDefines());
+    // builds a program listed in ShaderPrograms.txt, its generated Uniform<T>s can be set directly
+    Shader(const ProgramReflection& reflection, const ShaderDefines& defines = ShaderDefines());
+    // the program ID
+    unsigned int ID() const { return program->ID; }
+    // Shaders constructed between beginBatch() and endBatch() only submit their stages and link;
+    // the driver compiles them in parallel and the results are queried when a program is first needed
+    static void beginBatch();
+    static void endBatch();
+    // finishes the batched programs the driver is done with, call once per frame
+    static void pollPending();
+    // number of batched programs still compiling
+    static unsigned int pendingCount();
+    // uniform uploads and skips of every program since the last call, programs that set nothing are left out
+    static std::vector<ProgramUniformStats> takeUniformStats();
+    // every file the live programs were built from
+    static std::vector<std::string> sourceFiles();
+    // starts rebuilding the programs built from any of the files. The old program stays in use
+    // until pollPending() finds the rebuild linked, and for good if it fails
+    static void reloadChanged(const std::vector<std::string>& files);
+    // true once the program can be used. Never blocks with GL_KHR_parallel_shader_compile,
+    // without it there is no way to ask and this waits for the driver
+    bool isReady() const;
     // use/activate the shader
     void use();
+    // returns the handle of an active uniform (invalid if the linker optimized it out)
+    UniformHandle getUniform(const std::string& name) const;
     // utility uniform functions
     void setBool(const std::string& name, bool value) const;
     void setInt(const std::string& name, int value) const;
@@ -29,5 +175,42 @@ public:
     void setVec3(const std::string& name, float x, float y, float z) const;
     void setVec3(const std::string& name, glm::vec3 vec) const;
     void setVec2(const std::string& name, glm::vec2 vec) const;
-    ~Shader();
+    // same as above for already resolved uniforms
+    void setBool(UniformHandle uniform, bool value) const;
+    void setInt(UniformHandle uniform, int value) const;
+    void setFloat(UniformHandle uniform, float value) const;
+    void setMat4(UniformHandle uniform, const glm::mat4& value) const;
+    void setMat3(UniformHandle uniform, const glm::mat3& value) const;
+    void setVec3(UniformHandle uniform, float x, float y, float z) const;
+    void setVec3(UniformHandle uniform, const glm::vec3& vec) const;
+    void setVec2(UniformHandle uniform, const glm::vec2& vec) const;
+    // same as above for uniforms reflected at build time
+    void set(Uniform<bool> uniform, bool value) const { setBool(handleOf(uniform.program, uniform.slot), value); }
+    void set(Uniform<int> uniform, int value) const { setInt(handleOf(uniform.program, uniform.slot), value); }
+    void set(Uniform<float> uniform, float value) const { setFloat(handleOf(uniform.program, uniform.slot), value); }
+    void set(Uniform<glm::vec2> uniform, const glm::vec2& value) const { setVec2(handleOf(uniform.program, uniform.slot), value); }
+    void set(Uniform<glm::vec3> uniform, const glm::vec3& value) const { setVec3(handleOf(uniform.program, uniform.slot), value); }
+    void set(Uniform<glm::mat3> uniform, const glm::mat3& value) const { setMat3(handleOf(uniform.program, uniform.slot), value); }
+    void set(Uniform<glm::mat4> uniform, const glm::mat4& value) const { setMat4(handleOf(uniform.program, uniform.slot), value); }
+
+private:
+    std::shared_ptr<ShaderProgram> program;
+
+    // programs by their fully preprocessed stage sources, so every permutation is compiled once
+    static std::unordered_map<std::string, std::weak_ptr<ShaderProgram>> permutations;
+    static bool batching;
+    static std::vector<std::weak_ptr<ShaderProgram>> pending;
+    static std::vector<std::weak_ptr<ShaderProgram>> reloading;
+
+    // loads the sources and builds the program, or shares the one built from the same sources
+    void build(const char* vertexPath, const char* fragmentPath, const char* geometryPath, const ShaderDefines& defines, const ProgramReflection* reflection);
+    // finishes the rebuild if the driver is done with it and swaps it in when it linked
+    static bool pollReload(ShaderProgram& program);
+    // blocks until the program is ready, uniforms can't be looked up before
+    void waitReady() const;
+    // handle of a reflected uniform, checks in debug builds that it belongs to this program
+    UniformHandle handleOf(const ProgramReflection* reflection, int slot) const;
+    // location of a uniform set through a handle, -1 if it should be skipped
+    // because it is not active or already holds the value
+    GLint locationOf(UniformHandle uniform, GLenum type, const void* value, size_t size) const;
 };
@@ -0,0 +1,139 @@
+#include "ShaderCache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace ProgramBinaryCache
+{
+    Stats stats;
+
+    namespace
+    {
+        const char* CACHE_DIRECTORY = "./shader_cache";
+        const uint32_t FILE_MAGIC = 0x31434250; // "PBC1"
+
+        struct FileHeader
+        {
+            uint32_t magic;
+            uint32_t binaryFormat;
+            uint32_t length;
+            uint32_t reserved;
+            uint64_t key;
+        };
+
+        // FNV-1a, good enough to tell shader sources apart
+        void hashBytes(uint64_t& hash, const char* data, size_t size)
+        {
+            for (size_t i = 0; i < size; i++)
+            {
+                hash ^= (unsigned char)data[i];
+                hash *= 1099511628211ull;
+            }
+        }
+
+        void hashString(uint64_t& hash, const char* str)
+        {
+            if (str)
+                hashBytes(hash, str, std::strlen(str));
+            // separator so that ("ab", "c") and ("a", "bc") differ
+            hashBytes(hash, "\0", 1);
+        }
+
+        std::string pathOf(uint64_t key)
+        {
+            std::stringstream path;
+            path << CACHE_DIRECTORY << "/" << std::hex << key << ".bin";
+            return path.str();
+        }
+    }
+
+    bool available()
+    {
+        if (!GLAD_GL_ARB_get_program_binary)
+            return false;
+        int formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }
+
+    uint64_t makeKey(const std::vector<std::string>& sources)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        hashString(hash, (const char*)glGetString(GL_VENDOR));
+        hashString(hash, (const char*)glGetString(GL_RENDERER));
+        hashString(hash, (const char*)glGetString(GL_VERSION));
+        for (const std::string& source : sources)
+        {
+            hashBytes(hash, source.data(), source.size());
+            hashBytes(hash, "\0", 1);
+        }
+        return hash;
+    }
+
+    bool load(unsigned int program, uint64_t key)
+    {
+        std::ifstream file(pathOf(key), std::ios::binary);
+        FileHeader header;
+        if (!file || !file.read((char*)&header, sizeof(header)) || header.magic != FILE_MAGIC || header.key != key)
+        {
+            stats.misses++;
+            return false;
+        }
+        // the length comes from the file, a truncated or damaged one must not size the allocation
+        std::error_code error;
+        uintmax_t fileSize = std::filesystem::file_size(pathOf(key), error);
+        if (error || header.length == 0 || fileSize < sizeof(header) || header.length != fileSize - sizeof(header))
+        {
+            std::cout << "ERROR::SHADER_CACHE::FILE_CORRUPT " << pathOf(key) << std::endl;
+            file.close();
+            std::filesystem::remove(pathOf(key), error);
+            stats.misses++;
+            return false;
+        }
+        std::vector<char> binary(header.length);
+        if (!file.read(binary.data(), binary.size()))
+        {
+            stats.misses++;
+            return false;
+        }
+
+        glProgramBinary(program, header.binaryFormat, binary.data(), header.length);
+        int success;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            // driver changed its mind about the format, the caller compiles from source and overwrites the entry
+            std::cout << "WARNING::SHADER_CACHE::BINARY_REJECTED " << pathOf(key) << std::endl;
+            stats.misses++;
+            return false;
+        }
+        stats.hits++;
+        return true;
+    }
+
+    void store(unsigned int program, uint64_t key)
+    {
+        int length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+        std::vector<char> binary(length);
+        GLenum binaryFormat = 0;
+        glGetProgramBinary(program, length, NULL, &binaryFormat, binary.data());
+
+        std::error_code error;
+        std::filesystem::create_directories(CACHE_DIRECTORY, error);
+        std::ofstream file(pathOf(key), std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            std::cout << "ERROR::SHADER_CACHE::FILE_NOT_SUCCESFULLY_WRITTEN " << pathOf(key) << std::endl;
+            return;
+        }
+        FileHeader header = { FILE_MAGIC, binaryFormat, (uint32_t)length, 0, key };
+        file.write((const char*)&header, sizeof(header));
+        file.write(binary.data(), binary.size());
+    }
+}
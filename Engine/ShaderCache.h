@@ -0,0 +1,29 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// On-disk cache of linked program binaries (GL_ARB_get_program_binary).
+// Entries are keyed by the stage sources and the driver vendor/renderer/version strings,
+// so editing a shader or updating the driver simply misses and compiles from source again
+namespace ProgramBinaryCache
+{
+    struct Stats
+    {
+        unsigned int hits = 0;
+        unsigned int misses = 0;
+    };
+    extern Stats stats;
+
+    // true when the driver can hand out program binaries at all
+    bool available();
+    // hash of all stage sources and the driver strings
+    uint64_t makeKey(const std::vector<std::string>& sources);
+    // loads the cached binary into program, false if there is none or the driver rejected it
+    bool load(unsigned int program, uint64_t key);
+    // saves the binary of a successfully linked program
+    void store(unsigned int program, uint64_t key);
+}
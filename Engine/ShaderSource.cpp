@@ -0,0 +1,107 @@
+#include "ShaderSource.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace ShaderSource
+{
+    namespace
+    {
+        bool readFile(const std::string& path, std::string& contents)
+        {
+            std::ifstream file;
+            // ensure ifstream objects can throw exceptions:
+            file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+            try
+            {
+                file.open(path);
+                std::stringstream stream;
+                stream << file.rdbuf();
+                file.close();
+                contents = stream.str();
+                return true;
+            }
+            catch (std::ifstream::failure&)
+            {
+                std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << path << std::endl;
+                return false;
+            }
+        }
+
+        // returns true and the file name if the line is an #include "file" (or <file>) directive
+        bool parseInclude(const std::string& line, std::string& file)
+        {
+            size_t start = line.find_first_not_of(" \t");
+            if (start == std::string::npos || line.compare(start, 8, "#include") != 0)
+                return false;
+            size_t open = line.find_first_of("\"<", start + 8);
+            if (open == std::string::npos)
+                return false;
+            size_t close = line.find(line[open] == '"' ? '"' : '>', open + 1);
+            if (close == std::string::npos)
+                return false;
+            file = line.substr(open + 1, close - open - 1);
+            return true;
+        }
+
+        void expand(const std::string& path, std::string& output, std::vector<std::string>& files)
+        {
+            std::string source;
+            if (!readFile(path, source))
+                return;
+            // source string number used by #line, so compile errors point to the right file
+            int fileIndex = static_cast<int>(files.size());
+            files.push_back(path);
+
+            std::filesystem::path directory = std::filesystem::path(path).parent_path();
+            std::istringstream lines(source);
+            std::string line;
+            int lineNumber = 0;
+            while (std::getline(lines, line))
+            {
+                lineNumber++;
+                std::string include;
+                if (!parseInclude(line, include))
+                {
+                    output += line;
+                    output += '\n';
+                    continue;
+                }
+                std::string includePath = (directory / include).lexically_normal().generic_string();
+                if (std::find(files.begin(), files.end(), includePath) == files.end())
+                {
+                    output += "#line 1 " + std::to_string(files.size()) + "\n";
+                    expand(includePath, output, files);
+                }
+                output += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+            }
+        }
+    }
+
+    std::string load(const std::string& path, const ShaderDefines& defines, std::vector<std::string>& dependencies)
+    {
+        std::vector<std::string> files;
+        std::string source;
+        expand(std::filesystem::path(path).lexically_normal().generic_string(), source, files);
+        // stages sharing an include list it once
+        for (const std::string& file : files)
+            if (std::find(dependencies.begin(), dependencies.end(), file) == dependencies.end())
+                dependencies.push_back(file);
+        if (defines.empty())
+            return source;
+
+        // the defines have to follow #version, which must stay the first line
+        size_t insertAt = 0;
+        if (source.compare(0, 8, "#version") == 0)
+            insertAt = source.find('\n') + 1;
+        std::string injected;
+        for (const auto& define : defines)
+            injected += "#define " + define.first + " " + define.second + "\n";
+        injected += insertAt ? "#line 2 0\n" : "#line 1 0\n";
+        source.insert(insertAt, injected);
+        return source;
+    }
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+// preprocessor symbols injected right after the #version line, name -> value.
+// Ordered so that the same set always expands to the same source and therefore the same permutation
+typedef std::map<std::string, std::string> ShaderDefines;
+
+namespace ShaderSource
+{
+    // reads a shader stage, resolves #include "file" (relative to the including file, each file once)
+    // and injects the defines. Every file that went into the result is appended to dependencies unless it is there already
+    std::string load(const std::string& path, const ShaderDefines& defines, std::vector<std::string>& dependencies);
+}
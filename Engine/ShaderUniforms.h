@@ -0,0 +1,199 @@
+// generated by ShaderReflect from ShaderPrograms.txt, do not edit
+#pragma once
+
+#include <cstddef>
+
+#include <glm/glm/glm.hpp>
+
+#include "Shader.h"
+
+namespace ShaderUniforms
+{
+// scalar or vector array element, std140 pads each one to 16 bytes
+template <typename T>
+struct alignas(16) Std140Element
+{
+    T value;
+};
+
+// uniform blocks, the same in every program declaring them
+struct alignas(16) FrameData
+{
+    static constexpr const char* blockName = "FrameData";
+    static constexpr unsigned int binding = 0;
+
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProj;
+    glm::vec4 cameraPos;
+    float time;
+    float _pad0[3];
+};
+static_assert(sizeof(FrameData) == 224, "std140 size of FrameData");
+static_assert(offsetof(FrameData, view) == 0, "std140 offset of FrameData::view");
+static_assert(offsetof(FrameData, projection) == 64, "std140 offset of FrameData::projection");
+static_assert(offsetof(FrameData, viewProj) == 128, "std140 offset of FrameData::viewProj");
+static_assert(offsetof(FrameData, cameraPos) == 192, "std140 offset of FrameData::cameraPos");
+static_assert(offsetof(FrameData, time) == 208, "std140 offset of FrameData::time");
+
+struct alignas(16) DirLight
+{
+    glm::vec3 direction;
+    float _pad0[1];
+    glm::vec3 ambient;
+    float _pad1[1];
+    glm::vec3 diffuse;
+    float _pad2[1];
+    glm::vec3 specular;
+    float _pad3[1];
+};
+static_assert(sizeof(DirLight) == 64, "std140 size of DirLight");
+static_assert(offsetof(DirLight, direction) == 0, "std140 offset of DirLight::direction");
+static_assert(offsetof(DirLight, ambient) == 16, "std140 offset of DirLight::ambient");
+static_assert(offsetof(DirLight, diffuse) == 32, "std140 offset of DirLight::diffuse");
+static_assert(offsetof(DirLight, specular) == 48, "std140 offset of DirLight::specular");
+
+struct alignas(16) PointLight
+{
+    glm::vec3 position;
+    float constant;
+    float linear;
+    float quadratic;
+    float _pad0[2];
+    glm::vec3 ambient;
+    float _pad1[1];
+    glm::vec3 diffuse;
+    float _pad2[1];
+    glm::vec3 specular;
+    float _pad3[1];
+};
+static_assert(sizeof(PointLight) == 80, "std140 size of PointLight");
+static_assert(offsetof(PointLight, position) == 0, "std140 offset of PointLight::position");
+static_assert(offsetof(PointLight, constant) == 12, "std140 offset of PointLight::constant");
+static_assert(offsetof(PointLight, linear) == 16, "std140 offset of PointLight::linear");
+static_assert(offsetof(PointLight, quadratic) == 20, "std140 offset of PointLight::quadratic");
+static_assert(offsetof(PointLight, ambient) == 32, "std140 offset of PointLight::ambient");
+static_assert(offsetof(PointLight, diffuse) == 48, "std140 offset of PointLight::diffuse");
+static_assert(offsetof(PointLight, specular) == 64, "std140 offset of PointLight::specular");
+
+struct alignas(16) Lights
+{
+    static constexpr const char* blockName = "Lights";
+    static constexpr unsigned int binding = 1;
+
+    DirLight dirLight;
+    PointLight pointLights[4];
+};
+static_assert(sizeof(Lights) == 384, "std140 size of Lights");
+static_assert(offsetof(Lights, dirLight) == 0, "std140 offset of Lights::dirLight");
+static_assert(offsetof(Lights, pointLights) == 64, "std140 offset of Lights::pointLights");
+
+inline constexpr UniformBlockBinding uniformBlocks[] = {
+    { "FrameData", 0 },
+    { "Lights", 1 },
+};
+
+namespace Lighting
+{
+    inline constexpr const char* uniformNames[] = {
+        "model",
+        "normalMat",
+        "objectColor",
+        "material.diffuse",
+        "material.specular",
+        "material.shininess",
+    };
+    inline constexpr ProgramReflection reflection = { "Lighting", "./VertexShader.vert", "./FragmentShader.frag", nullptr, uniformNames, 6 };
+
+    inline constexpr Uniform<glm::mat4> model = { &reflection, 0 };
+    inline constexpr Uniform<glm::mat3> normalMat = { &reflection, 1 };
+    inline constexpr Uniform<glm::vec3> objectColor = { &reflection, 2 };
+    inline constexpr Uniform<int> material_diffuse = { &reflection, 3 };
+    inline constexpr Uniform<int> material_specular = { &reflection, 4 };
+    inline constexpr Uniform<float> material_shininess = { &reflection, 5 };
+}
+
+namespace LightSource
+{
+    inline constexpr const char* uniformNames[] = {
+        "model",
+        "lightColor",
+    };
+    inline constexpr ProgramReflection reflection = { "LightSource", "./LightSource.vert", "./LightSource.frag", nullptr, uniformNames, 2 };
+
+    inline constexpr Uniform<glm::mat4> model = { &reflection, 0 };
+    inline constexpr Uniform<glm::vec3> lightColor = { &reflection, 1 };
+}
+
+namespace Alpha
+{
+    inline constexpr const char* uniformNames[] = {
+        "model",
+        "normalMat",
+        "texture1",
+    };
+    inline constexpr ProgramReflection reflection = { "Alpha", "./VertexShader.vert", "./BasicFragmentShader.frag", nullptr, uniformNames, 3 };
+
+    inline constexpr Uniform<glm::mat4> model = { &reflection, 0 };
+    inline constexpr Uniform<glm::mat3> normalMat = { &reflection, 1 };
+    inline constexpr Uniform<int> texture1 = { &reflection, 2 };
+}
+
+namespace Postprocess
+{
+    inline constexpr const char* uniformNames[] = {
+        "screenTexture",
+    };
+    inline constexpr ProgramReflection reflection = { "Postprocess", "./Framebuffer.vert", "./Postprocess.frag", nullptr, uniformNames, 1 };
+
+    inline constexpr Uniform<int> screenTexture = { &reflection, 0 };
+}
+
+namespace Skybox
+{
+    inline constexpr const char* uniformNames[] = {
+        "skybox",
+    };
+    inline constexpr ProgramReflection reflection = { "Skybox", "./Cubemap.vert", "./Cubemap.frag", nullptr, uniformNames, 1 };
+
+    inline constexpr Uniform<int> skybox = { &reflection, 0 };
+}
+
+namespace Reflection
+{
+    inline constexpr const char* uniformNames[] = {
+        "model",
+        "skybox",
+    };
+    inline constexpr ProgramReflection reflection = { "Reflection", "./Reflection.vert", "./Reflection.frag", nullptr, uniformNames, 2 };
+
+    inline constexpr Uniform<glm::mat4> model = { &reflection, 0 };
+    inline constexpr Uniform<int> skybox = { &reflection, 1 };
+}
+
+namespace Points
+{
+    inline constexpr ProgramReflection reflection = { "Points", "./XY.vert", "./Mono.frag", "./Geomerty.geom", nullptr, 0 };
+}
+
+namespace Normals
+{
+    inline constexpr const char* uniformNames[] = {
+        "model",
+    };
+    inline constexpr ProgramReflection reflection = { "Normals", "./Model.vert", "./Yellow.frag", "./Normals.geom", uniformNames, 1 };
+
+    inline constexpr Uniform<glm::mat4> model = { &reflection, 0 };
+}
+
+namespace Asteroids
+{
+    inline constexpr const char* uniformNames[] = {
+        "texture_diffuse1",
+    };
+    inline constexpr ProgramReflection reflection = { "Asteroids", "./Instancing.vert", "./Asteroids.frag", nullptr, uniformNames, 1 };
+
+    inline constexpr Uniform<int> texture_diffuse1 = { &reflection, 0 };
+}
+
+}
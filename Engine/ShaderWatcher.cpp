@@ -0,0 +1,115 @@
+#include "ShaderWatcher.h"
+
+#include <algorithm>
+#include <iostream>
+#include <system_error>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    std::filesystem::file_time_type modificationTime(const std::string& path)
+    {
+        std::error_code error;
+        std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+        return error ? std::filesystem::file_time_type::min() : time;
+    }
+
+    // same normalization ShaderSource applies to the paths it records
+    std::string normalize(const std::filesystem::path& path)
+    {
+        return path.lexically_normal().generic_string();
+    }
+}
+
+ShaderWatcher::ShaderWatcher()
+{
+#ifdef __linux__
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0)
+        std::cout << "WARNING::SHADER_WATCHER::INOTIFY_UNAVAILABLE falling back to polling" << std::endl;
+#endif
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+#ifdef __linux__
+    if (inotifyFd >= 0)
+        close(inotifyFd);
+#endif
+}
+
+void ShaderWatcher::watch(const std::vector<std::string>& paths)
+{
+    for (const std::string& path : paths)
+    {
+        std::string file = normalize(path);
+        auto known = std::find_if(files.begin(), files.end(), [&](const WatchedFile& watched) { return watched.path == file; });
+        if (known != files.end())
+            continue;
+        files.push_back({ file, modificationTime(file) });
+
+#ifdef __linux__
+        // editors often save by writing a new file and renaming it over the old one, so the directory is watched
+        std::string directory = std::filesystem::path(file).parent_path().generic_string();
+        if (directory.empty())
+            directory = ".";
+        bool watched = std::any_of(directories.begin(), directories.end(), [&](const std::pair<int, std::string>& entry) { return entry.second == directory; });
+        if (inotifyFd >= 0 && !watched)
+        {
+            int wd = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+            if (wd >= 0)
+                directories.push_back({ wd, directory });
+        }
+#endif
+    }
+}
+
+std::vector<std::string> ShaderWatcher::changedFiles()
+{
+    std::vector<std::string> changed;
+#ifdef __linux__
+    if (inotifyFd >= 0)
+    {
+        alignas(inotify_event) char buffer[4096];
+        ssize_t length;
+        while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0)
+        {
+            for (char* ptr = buffer; ptr < buffer + length;)
+            {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(ptr);
+                ptr += sizeof(inotify_event) + event->len;
+                if (!event->len)
+                    continue;
+                auto directory = std::find_if(directories.begin(), directories.end(), [&](const std::pair<int, std::string>& entry) { return entry.first == event->wd; });
+                if (directory == directories.end())
+                    continue;
+                // every file of the directory is reported, a new include may not be watched yet
+                std::string file = normalize(std::filesystem::path(directory->second) / event->name);
+                if (std::find(changed.begin(), changed.end(), file) == changed.end())
+                    changed.push_back(file);
+            }
+        }
+        return changed;
+    }
+#else
+    // a stat per file is cheap, but not every frame
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastCheck < std::chrono::milliseconds(250))
+        return changed;
+    lastCheck = now;
+#endif
+    for (WatchedFile& file : files)
+    {
+        std::filesystem::file_time_type modified = modificationTime(file.path);
+        if (modified != file.modified)
+        {
+            file.modified = modified;
+            changed.push_back(file.path);
+        }
+    }
+    return changed;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Reports shader files edited on disk so the programs built from them can be reloaded while running.
+// Uses inotify on Linux, elsewhere it compares modification times a few times per second
+class ShaderWatcher
+{
+public:
+    ShaderWatcher();
+    ~ShaderWatcher();
+    ShaderWatcher(const ShaderWatcher&) = delete;
+    ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+    // starts watching the files, paths as Shader::sourceFiles() reports them
+    void watch(const std::vector<std::string>& files);
+    // files written since the last call, never blocks
+    std::vector<std::string> changedFiles();
+
+private:
+    struct WatchedFile
+    {
+        std::string path;
+        std::filesystem::file_time_type modified;
+    };
+
+#ifdef __linux__
+    int inotifyFd = -1;
+    // watch descriptor -> directory, inotify reports names relative to it
+    std::vector<std::pair<int, std::string>> directories;
+#else
+    std::chrono::steady_clock::time_point lastCheck;
+#endif
+    std::vector<WatchedFile> files;
+};
@@ -0,0 +1,88 @@
+#include "TextureCache.h"
+#include "GLState.h"
+#include "TextureStreamer.h"
+
+#include <filesystem>
+
+TextureCache& TextureCache::global()
+{
+    static TextureCache cache;
+    return cache;
+}
+
+std::string TextureCache::makeKey(const std::string& path, const TextureSettings& settings)
+{
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+    if (error)
+        canonical = std::filesystem::path(path).lexically_normal();
+    return canonical.generic_string() + '|' + std::to_string(settings.wrap) + '|' + std::to_string(settings.minFilter) + '|'
+        + (settings.flipVertically ? '1' : '0') + '|' + std::to_string(settings.internalFormat) + '|' + std::to_string(settings.format);
+}
+
+unsigned int TextureCache::acquire(const std::string& path, const TextureSettings& settings, const Create& create)
+{
+    std::string key = makeKey(path, settings);
+    auto found = entries.find(key);
+    if (found != entries.end())
+    {
+        found->second.references++;
+        counters.hits++;
+        counters.savedBytes += found->second.bytes;
+        return found->second.id;
+    }
+
+    Entry entry;
+    entry.id = create(entry.bytes);
+    entry.references = 1;
+    counters.misses++;
+    counters.residentBytes += entry.bytes;
+    keys[entry.id] = key;
+    entries[key] = entry;
+    return entry.id;
+}
+
+void TextureCache::release(unsigned int id)
+{
+    auto key = keys.find(id);
+    if (key == keys.end())
+        return;
+    auto entry = entries.find(key->second);
+    if (--entry->second.references > 0)
+        return;
+
+    counters.residentBytes -= entry->second.bytes;
+    TextureStreamer::global().cancel(id);
+    glDeleteTextures(1, &id);
+    // the name may come back for a new texture while the mirror still thinks the old one is bound
+    GLState::invalidate();
+    entries.erase(entry);
+    keys.erase(key);
+}
+
+void TextureCache::clear()
+{
+    for (const auto& entry : entries)
+        glDeleteTextures(1, &entry.second.id);
+    entries.clear();
+    keys.clear();
+    counters.residentBytes = 0;
+    GLState::invalidate();
+}
+
+TextureCache::Stats TextureCache::stats() const
+{
+    return counters;
+}
+
+size_t TextureCache::size() const
+{
+    return entries.size();
+}
+
+size_t TextureCache::textureBytes(int width, int height, int components)
+{
+    // the mip chain adds a third
+    size_t base = (size_t)width * (size_t)height * (size_t)components;
+    return base + base / 3;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+// what besides the file decides the contents and sampling of a texture, part of its cache key
+struct TextureSettings
+{
+    GLenum wrap = GL_REPEAT;
+    GLenum minFilter = GL_NEAREST_MIPMAP_LINEAR; // the GL default
+    bool flipVertically = true;
+    // 0 takes them from the number of components in the file
+    GLenum internalFormat = 0;
+    GLenum format = 0;
+
+    // components stored on the GPU for a file with fileComponents
+    int components(int fileComponents) const
+    {
+        switch (internalFormat)
+        {
+        case GL_RED: return 1;
+        case GL_RGB: return 3;
+        case GL_RGBA: return 4;
+        default: return fileComponents;
+        }
+    }
+};
+
+// Every 2D texture loaded from a file, shared by all models and main. Keyed by the canonical path and the
+// settings, so the same file reached through different relative paths is still one texture. Textures are
+// reference counted and deleted when the last user releases them. GL thread only, the decoding that
+// happens elsewhere goes through TextureStreamer
+class TextureCache
+{
+public:
+    struct Stats
+    {
+        unsigned int hits = 0;
+        unsigned int misses = 0;
+        // estimated GPU bytes of the resident textures with their mip chains, and what the hits didn't upload again
+        size_t residentBytes = 0;
+        size_t savedBytes = 0;
+    };
+
+    // creates the texture on a miss, returns its id and sets bytes to its estimated GPU size
+    typedef std::function<unsigned int(size_t& bytes)> Create;
+
+    static TextureCache& global();
+
+    TextureCache() = default;
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    // the texture of path with these settings, taking a reference. Created with create if it isn't resident
+    unsigned int acquire(const std::string& path, const TextureSettings& settings, const Create& create);
+    // drops a reference taken by acquire, the texture is deleted with the last one
+    void release(unsigned int id);
+    // deletes every texture still resident, whoever holds it. For shutdown, while the context is current
+    void clear();
+
+    Stats stats() const;
+    size_t size() const;
+
+    // GPU bytes of a width x height texture with a full mip chain
+    static size_t textureBytes(int width, int height, int components);
+
+private:
+    struct Entry
+    {
+        unsigned int id = 0;
+        unsigned int references = 0;
+        size_t bytes = 0;
+    };
+
+    std::unordered_map<std::string, Entry> entries;
+    // id -> key of its entry, for release
+    std::unordered_map<unsigned int, std::string> keys;
+    Stats counters;
+
+    static std::string makeKey(const std::string& path, const TextureSettings& settings);
+};
@@ -0,0 +1,135 @@
+#include "TextureStreamer.h"
+#include "GLState.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+TextureStreamer& TextureStreamer::global()
+{
+    static TextureStreamer streamer;
+    return streamer;
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    release();
+}
+
+void TextureStreamer::release()
+{
+    pending.clear();
+    if (unpackBuffer)
+        glDeleteBuffers(1, &unpackBuffer);
+    unpackBuffer = 0;
+    unpackBufferSize = 0;
+}
+
+DecodedImage TextureStreamer::decode(const std::string& path, bool flipVertically)
+{
+    DecodedImage image;
+    // the global flag belongs to the GL thread
+    stbi_set_flip_vertically_on_load_thread(flipVertically);
+    image.pixels.reset(stbi_load(path.c_str(), &image.width, &image.height, &image.components, 0));
+    if (!image.pixels)
+        std::cout << "Texture failed to load at path: " << path << std::endl;
+    return image;
+}
+
+unsigned int TextureStreamer::load(const std::string& path, const TextureSettings& settings, const unsigned char placeholder[4], size_t& bytes)
+{
+    // only the header is read here, the size is known before the pixels are
+    int width = 0, height = 0, components = 0;
+    bytes = stbi_info(path.c_str(), &width, &height, &components) ? TextureCache::textureBytes(width, height, settings.components(components)) : 0;
+
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    GLState::bindTextureUnit(0, GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, settings.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, settings.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, settings.minFilter);
+    // a single 1x1 level is mipmap complete, so the placeholder samples with any filter
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+
+    bool flip = settings.flipVertically;
+    pending.push_back({ texture, settings, ThreadPool::global().submit([path, flip]() { return decode(path, flip); }) });
+    counters.requested++;
+    return texture;
+}
+
+void TextureStreamer::update(size_t budget)
+{
+    size_t spent = 0;
+    for (auto request = pending.begin(); request != pending.end() && spent < budget;)
+    {
+        if (request->image.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            request++;
+            continue;
+        }
+        DecodedImage image = request->image.get();
+        if (image.pixels)
+        {
+            upload(*request, image);
+            size_t bytes = (size_t)image.width * image.height * image.components;
+            spent += bytes;
+            counters.uploaded++;
+            counters.uploadedBytes += bytes;
+        }
+        // a file that failed to decode keeps its placeholder
+        request = pending.erase(request);
+    }
+}
+
+void TextureStreamer::cancel(unsigned int texture)
+{
+    for (auto request = pending.begin(); request != pending.end(); request++)
+    {
+        if (request->texture == texture)
+        {
+            // the worker still finishes the decode, its result is dropped with the future
+            pending.erase(request);
+            return;
+        }
+    }
+}
+
+void TextureStreamer::upload(const Pending& request, const DecodedImage& image)
+{
+    size_t size = (size_t)image.width * image.height * image.components;
+    if (!unpackBuffer)
+        glGenBuffers(1, &unpackBuffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, unpackBuffer);
+    // storage is only (re)allocated to grow. Otherwise mapping with GL_MAP_INVALIDATE_BUFFER_BIT orphans it, so the
+    // driver hands out fresh memory while the previous upload may still read the old one
+    if (size > unpackBufferSize)
+    {
+        unpackBufferSize = size;
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, unpackBufferSize, nullptr, GL_STREAM_DRAW);
+    }
+    // the pixels pointer is an offset into the unpack buffer while it is bound
+    const void* pixels = nullptr;
+    // this copy still runs on the GL thread, only the transfer to the texture is asynchronous. Decoding straight
+    // into the buffer would keep one mapped buffer per queued image for the whole decode, sized from the header,
+    // and an image rarely costs more to copy than the glGenerateMipmap that follows it
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped)
+    {
+        std::memcpy(mapped, image.pixels.get(), size);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+    else
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        pixels = image.pixels.get();
+    }
+
+    GLenum format = image.components == 1 ? GL_RED : image.components == 3 ? GL_RGB : GL_RGBA;
+    GLenum internalFormat = request.settings.internalFormat ? request.settings.internalFormat : format;
+    GLenum sourceFormat = request.settings.format ? request.settings.format : format;
+    GLState::bindTextureUnit(0, GL_TEXTURE_2D, request.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, sourceFormat, GL_UNSIGNED_BYTE, pixels);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
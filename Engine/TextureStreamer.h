@@ -0,0 +1,77 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+
+#include "TextureCache.h"
+#include "stb_image.h"
+
+// pixels of one image file, decoded on any thread
+struct DecodedImage
+{
+    int width = 0, height = 0, components = 0;
+    std::unique_ptr<unsigned char, void (*)(void*)> pixels{ nullptr, stbi_image_free };
+};
+
+// Loads 2D textures without stalling the GL thread. load() creates the texture at once with a 1x1 placeholder
+// and decodes the file on the ThreadPool. update(), called once per frame, uploads the finished images through
+// a pixel unpack buffer until the frame's byte budget is spent. The texture name never changes, so whatever
+// holds it simply starts sampling the real image once it is resident
+class TextureStreamer
+{
+public:
+    // bytes uploaded per update, at least one texture goes through whatever its size
+    static const size_t DEFAULT_BUDGET = 8 * 1024 * 1024;
+
+    struct Stats
+    {
+        unsigned int requested = 0;
+        unsigned int uploaded = 0;
+        size_t uploadedBytes = 0;
+    };
+
+    static TextureStreamer& global();
+
+    TextureStreamer() = default;
+    ~TextureStreamer();
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // the texture for the file, showing placeholder (RGBA) until the decoded image is uploaded.
+    // bytes is set to its estimated GPU size from the image header. GL thread only
+    unsigned int load(const std::string& path, const TextureSettings& settings, const unsigned char placeholder[4], size_t& bytes);
+    // uploads the images decoded so far, oldest first, until budget bytes are spent. GL thread only
+    void update(size_t budget = DEFAULT_BUDGET);
+    // drops the pending textures and deletes the unpack buffer. For shutdown, while the context is current
+    void release();
+    // forgets the texture if it is still waiting for its image, before it is deleted
+    void cancel(unsigned int texture);
+
+    // textures still showing their placeholder
+    size_t pendingCount() const { return pending.size(); }
+    const Stats& stats() const { return counters; }
+
+    // reads the file, flipped or not independently of the other threads
+    static DecodedImage decode(const std::string& path, bool flipVertically);
+
+private:
+    struct Pending
+    {
+        unsigned int texture;
+        TextureSettings settings;
+        std::future<DecodedImage> image;
+    };
+
+    std::deque<Pending> pending;
+    // reused for every upload, grown to the largest image
+    unsigned int unpackBuffer = 0;
+    size_t unpackBufferSize = 0;
+    Stats counters;
+
+    void upload(const Pending& request, const DecodedImage& image);
+};
@@ -0,0 +1,106 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+ThreadPool::ThreadPool(unsigned int threads)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    workers.reserve(threads);
+    for (unsigned int i = 0; i < threads; i++)
+        workers.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+ThreadPool& ThreadPool::global()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body)
+{
+    if (count == 0)
+        return;
+    // shared with the helpers, which may only get to run after every index is taken and the caller is gone
+    struct Loop
+    {
+        std::function<void(size_t)> body;
+        size_t count = 0;
+        std::atomic<size_t> next{ 0 };
+        size_t pending = 0;
+        std::mutex mutex;
+        std::condition_variable done;
+        // the first exception of any body, thrown again on the calling thread
+        std::exception_ptr error;
+
+        void run()
+        {
+            for (size_t index = next++; index < count; index = next++)
+            {
+                // a throw must not leave the worker, it would terminate the process
+                std::exception_ptr thrown;
+                try
+                {
+                    body(index);
+                }
+                catch (...)
+                {
+                    thrown = std::current_exception();
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                if (thrown && !error)
+                    error = thrown;
+                if (--pending == 0)
+                    done.notify_all();
+            }
+        }
+    };
+    auto loop = std::make_shared<Loop>();
+    loop->body = body;
+    loop->count = count;
+    loop->pending = count;
+
+    size_t helpers = std::min<size_t>(count - 1, workers.size());
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < helpers; i++)
+            tasks.push([loop]() { loop->run(); });
+    }
+    wake.notify_all();
+
+    loop->run();
+    std::unique_lock<std::mutex> lock(loop->mutex);
+    loop->done.wait(lock, [&loop]() { return loop->pending == 0; });
+    if (loop->error)
+        std::rethrow_exception(loop->error);
+}
+
+void ThreadPool::work()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (tasks.empty())
+                return;
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
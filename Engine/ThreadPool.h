@@ -0,0 +1,58 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running submitted tasks in order. Tasks must not touch GL,
+// the context belongs to the main thread
+class ThreadPool
+{
+public:
+    // one worker per hardware thread unless told otherwise
+    explicit ThreadPool(unsigned int threads = 0);
+    // finishes the queued tasks, then joins the workers
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // the pool loading runs on
+    static ThreadPool& global();
+
+    // queues the task, the future gets its result or the exception it threw
+    template <typename F>
+    auto submit(F&& task) -> std::future<decltype(task())>
+    {
+        typedef decltype(task()) Result;
+        // std::function needs something copyable, the packaged task is not
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> result = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push([packaged]() { (*packaged)(); });
+        }
+        wake.notify_one();
+        return result;
+    }
+
+    // calls body for every index in 0..count, spread over the workers and the calling thread, and returns once
+    // all are done. The caller claims indices too, so it is safe to call from inside a task of this pool.
+    // If bodies throw, the rest still run and the first exception is rethrown here
+    void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    unsigned int size() const { return static_cast<unsigned int>(workers.size()); }
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    void work();
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Uniform buffer holding one std140 block generated by ShaderReflect (ShaderUniforms.h),
+// attached to the binding point every program gets that block bound to
+template <typename Block>
+class UniformBuffer
+{
+public:
+    unsigned int UBO;
+
+    // creates the buffer, requires a current context
+    UniformBuffer()
+    {
+        glGenBuffers(1, &UBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, Block::binding, UBO);
+    }
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+    // uploads the whole block at once, the layouts match so it is a plain copy
+    void update(const Block& data)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    ~UniformBuffer()
+    {
+        glDeleteBuffers(1, &UBO);
+    }
+};
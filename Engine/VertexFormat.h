@@ -0,0 +1,154 @@
+#pragma once
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+#include <glm/glm/glm.hpp>
+#include <glm/glm/gtc/packing.hpp>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "VertexLayout.h"
+
+#define MAX_BONE_INFLUENCE 4
+
+struct Vertex {
+    // position
+    glm::vec3 Position;
+    // normal
+    glm::vec3 Normal;
+    // texCoords
+    glm::vec2 TexCoords;
+    // tangent
+    glm::vec3 Tangent;
+    // bitangent
+    glm::vec3 Bitangent;
+    //bone indexes which will influence this vertex
+    int m_BoneIDs[MAX_BONE_INFLUENCE];
+    //weights from each bone
+    float m_Weights[MAX_BONE_INFLUENCE];
+};
+
+// Vertex as it is on the GPU for skinned meshes
+typedef VertexLayout<Pos3f, Normal3f, UV2f, Tangent3f, Bitangent3f, BoneIds4i, Weights4f> SkinnedVertexLayout;
+static_assert(SkinnedVertexLayout::stride == sizeof(Vertex), "SkinnedVertexLayout doesn't match Vertex");
+static_assert(SkinnedVertexLayout::offsetOf(5) == offsetof(Vertex, m_BoneIDs), "SkinnedVertexLayout doesn't match Vertex");
+static_assert(SkinnedVertexLayout::offsetOf(6) == offsetof(Vertex, m_Weights), "SkinnedVertexLayout doesn't match Vertex");
+
+// Layout a mesh is uploaded with, decided by which attributes the source mesh actually has.
+// Static meshes are packed, 24 bytes for a full vertex instead of the 88 of Vertex:
+//   0 position  3 x float
+//   1 normal    GL_INT_2_10_10_10_REV, normalized
+//   2 uv        2 x GL_HALF_FLOAT
+//   3 tangent   GL_INT_2_10_10_10_REV, normalized, w = handedness: bitangent = cross(normal, tangent.xyz) * tangent.w
+// Missing attributes are left out of the stride and read as the (0, 0, 0, 1) default.
+// Skinned meshes keep the float layout of Vertex including bone IDs and weights (locations 4-6)
+struct VertexFormat
+{
+    bool normals = true;
+    bool texCoords = true;
+    bool tangents = true;
+    bool skinned = false;
+
+    // nothing but the 12 byte position, for passes that only need where the triangles are
+    static VertexFormat positionOnly()
+    {
+        VertexFormat format;
+        format.normals = format.texCoords = format.tangents = false;
+        return format;
+    }
+
+    bool operator==(const VertexFormat& other) const
+    {
+        return normals == other.normals && texCoords == other.texCoords && tangents == other.tangents && skinned == other.skinned;
+    }
+
+    // bytes per vertex on the GPU
+    unsigned int stride() const
+    {
+        if (skinned)
+            return sizeof(Vertex);
+        return 3 * sizeof(float) + (normals ? 4 : 0) + (texCoords ? 4 : 0) + (tangents ? 4 : 0);
+    }
+
+    // the vertices in this layout, ready for glBufferData
+    std::vector<unsigned char> pack(const std::vector<Vertex>& vertices) const
+    {
+        std::vector<unsigned char> data(vertices.size() * stride());
+        if (skinned)
+        {
+            if (!vertices.empty())
+                std::memcpy(data.data(), vertices.data(), data.size());
+            return data;
+        }
+
+        unsigned char* out = data.data();
+        for (const Vertex& vertex : vertices)
+        {
+            std::memcpy(out, &vertex.Position, 3 * sizeof(float));
+            out += 3 * sizeof(float);
+            if (normals)
+                out = write(out, glm::packSnorm3x10_1x2(glm::vec4(unitOr(vertex.Normal, glm::vec3(0.0f, 0.0f, 1.0f)), 0.0f)));
+            if (texCoords)
+                out = write(out, glm::packHalf2x16(vertex.TexCoords));
+            if (tangents)
+            {
+                float handedness = glm::dot(glm::cross(vertex.Normal, vertex.Tangent), vertex.Bitangent) < 0.0f ? -1.0f : 1.0f;
+                // meshes without UVs get zero tangents from assimp, any axis across the normal will do for them
+                glm::vec3 normal = unitOr(vertex.Normal, glm::vec3(0.0f, 0.0f, 1.0f));
+                glm::vec3 across = std::abs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+                glm::vec3 tangent = unitOr(vertex.Tangent, glm::normalize(glm::cross(normal, across)));
+                out = write(out, glm::packSnorm3x10_1x2(glm::vec4(tangent, handedness)));
+            }
+        }
+        return data;
+    }
+
+    // sets the attribute pointers of the bound VAO for a buffer filled by pack()
+    void setAttributes() const
+    {
+        if (skinned)
+        {
+            SkinnedVertexLayout::setAttributes(VertexStreams::Interleaved, 0);
+            return;
+        }
+        GLsizei size = stride();
+        size_t offset = 0;
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, size, (void*)offset);
+        offset += 3 * sizeof(float);
+        if (normals)
+        {
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, size, (void*)offset);
+            offset += 4;
+        }
+        if (texCoords)
+        {
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, size, (void*)offset);
+            offset += 4;
+        }
+        if (tangents)
+        {
+            glEnableVertexAttribArray(3);
+            glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, size, (void*)offset);
+            offset += 4;
+        }
+    }
+
+private:
+    // the direction of v, or fallback when v is too short (or not finite) to have one. glm::normalize would give NaN
+    static glm::vec3 unitOr(const glm::vec3& v, const glm::vec3& fallback)
+    {
+        float lengthSquared = glm::dot(v, v);
+        return lengthSquared > 1e-12f && lengthSquared < INFINITY ? v / std::sqrt(lengthSquared) : fallback;
+    }
+
+    static unsigned char* write(unsigned char* out, uint32_t value)
+    {
+        std::memcpy(out, &value, sizeof(value));
+        return out + sizeof(value);
+    }
+};
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+// Vertex layouts described as types, VertexLayout<Pos3f, Normal3f, UV2f>. Stride and offsets are computed
+// at compile time and setAttributes() issues the glVertexAttrib*Pointer calls for them.
+// The same layout can be stored interleaved (one vertex after the other) or split into one stream per
+// attribute (all positions, then all normals...), picked by vertexStreams when the data is uploaded
+
+enum class VertexStreams
+{
+    Interleaved,
+    Split
+};
+
+// the arrangement createBuffer() uploads in, main sets it from the command line
+inline VertexStreams vertexStreams = VertexStreams::Interleaved;
+
+constexpr size_t attributeSize(unsigned int components, GLenum type)
+{
+    switch (type)
+    {
+    case GL_INT_2_10_10_10_REV:
+    case GL_UNSIGNED_INT_2_10_10_10_REV:
+        return 4;
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE:
+        return components;
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+    case GL_HALF_FLOAT:
+        return 2 * components;
+    default:
+        return 4 * components;
+    }
+}
+
+// attribute read as floats, integer types are converted (and normalized if asked)
+template <unsigned int Location, unsigned int Components, GLenum Type = GL_FLOAT, bool Normalized = false>
+struct Attribute
+{
+    static constexpr bool used = true;
+    static constexpr bool integer = false;
+    static constexpr unsigned int location = Location;
+    static constexpr unsigned int components = Components;
+    static constexpr GLenum type = Type;
+    static constexpr GLboolean normalized = Normalized ? GL_TRUE : GL_FALSE;
+    static constexpr size_t size = attributeSize(Components, Type);
+};
+
+// attribute read as integers by the shader (ivec, uvec)
+template <unsigned int Location, unsigned int Components, GLenum Type = GL_INT>
+struct IntegerAttribute : Attribute<Location, Components, Type>
+{
+    static constexpr bool integer = true;
+};
+
+// data in the buffer that this layout doesn't feed to the shader
+template <unsigned int Components, GLenum Type = GL_FLOAT>
+struct Unused : Attribute<0, Components, Type>
+{
+    static constexpr bool used = false;
+};
+
+typedef Attribute<0, 2> Pos2f;
+typedef Attribute<0, 3> Pos3f;
+typedef Attribute<1, 3> Normal3f;
+typedef Attribute<1, 3> Color3f;
+typedef Attribute<2, 2> UV2f;
+typedef Attribute<3, 3> Tangent3f;
+typedef Attribute<4, 3> Bitangent3f;
+typedef IntegerAttribute<5, 4> BoneIds4i;
+typedef Attribute<6, 4> Weights4f;
+
+template <typename... Attributes>
+struct VertexLayout
+{
+    static_assert(sizeof...(Attributes) > 0, "a vertex layout needs at least one attribute");
+
+    static constexpr size_t stride = (Attributes::size + ...);
+
+    // bytes of the attributes before attribute i, within a vertex when interleaved and per vertex when split
+    static constexpr size_t offsetOf(size_t i)
+    {
+        constexpr size_t sizes[] = { Attributes::size... };
+        size_t offset = 0;
+        for (size_t a = 0; a < i; a++)
+            offset += sizes[a];
+        return offset;
+    }
+
+    // sets the attribute pointers of the bound VAO for vertexCount vertices starting at offset
+    // in the buffer bound to GL_ARRAY_BUFFER. A divisor makes them per instance
+    static void setAttributes(VertexStreams streams, size_t vertexCount, size_t offset = 0, GLuint divisor = 0)
+    {
+        size_t i = 0;
+        (setAttribute<Attributes>(streams, vertexCount, offset, divisor, i++), ...);
+    }
+
+    // interleaved source data arranged for the streams
+    static std::vector<unsigned char> arrange(const void* interleaved, size_t vertexCount, VertexStreams streams)
+    {
+        std::vector<unsigned char> data(vertexCount * stride);
+        const unsigned char* source = static_cast<const unsigned char*>(interleaved);
+        if (streams == VertexStreams::Interleaved)
+        {
+            if (!data.empty())
+                std::memcpy(data.data(), source, data.size());
+            return data;
+        }
+
+        constexpr size_t sizes[] = { Attributes::size... };
+        for (size_t a = 0; a < sizeof...(Attributes); a++)
+        {
+            unsigned char* stream = data.data() + vertexCount * offsetOf(a);
+            for (size_t v = 0; v < vertexCount; v++)
+                std::memcpy(stream + v * sizes[a], source + v * stride + offsetOf(a), sizes[a]);
+        }
+        return data;
+    }
+
+    // creates a buffer holding the interleaved source data in the vertexStreams arrangement
+    // and points the attributes of the bound VAO at it
+    static unsigned int createBuffer(const void* interleaved, size_t bytes, GLenum usage = GL_STATIC_DRAW)
+    {
+        size_t vertexCount = bytes / stride;
+        std::vector<unsigned char> data = arrange(interleaved, vertexCount, vertexStreams);
+        unsigned int buffer;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER, data.size(), data.data(), usage);
+        setAttributes(vertexStreams, vertexCount);
+        return buffer;
+    }
+
+private:
+    template <typename A>
+    static void setAttribute(VertexStreams streams, size_t vertexCount, size_t offset, GLuint divisor, size_t index)
+    {
+        if (!A::used)
+            return;
+        bool split = streams == VertexStreams::Split;
+        void* pointer = (void*)(offset + (split ? vertexCount : 1) * offsetOf(index));
+        GLsizei attributeStride = static_cast<GLsizei>(split ? A::size : stride);
+        glEnableVertexAttribArray(A::location);
+        if (A::integer)
+            glVertexAttribIPointer(A::location, A::components, A::type, attributeStride, pointer);
+        else
+            glVertexAttribPointer(A::location, A::components, A::type, A::normalized, attributeStride, pointer);
+        if (divisor)
+            glVertexAttribDivisor(A::location, divisor);
+    }
+};
@@ -4,10 +4,10 @@ layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 uniform mat3 normalMat;
 
+#include "FrameData.glsl"
+
 out vec3 Normal;
 out vec3 FragPos;
 out vec2 TexCoords;
@@ -20,7 +20,7 @@ out VS_OUT {
 
 void main()
 {
-	gl_Position = projection * view * model * vec4(aPos, 1.0);
+	gl_Position = viewProj * model * vec4(aPos, 1.0);
 	FragPos = vec3(model * vec4(aPos, 1.0));
 	Normal = normalMat * aNormal;
 	TexCoords = aTexCoords;
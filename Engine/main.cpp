@@ -9,8 +9,20 @@
 #include "Constants.h"
 #include "Camera.h"
 #include "Model.h"
+#include "FrameData.h"
+#include "GLState.h"
+#include "ShaderCache.h"
+#include "ShaderUniforms.h"
+#include "ShaderWatcher.h"
+#include "UniformBuffer.h"
+#include "Primitives.h"
+#include "TextureCache.h"
+#include "TextureStreamer.h"
+#include "ThreadPool.h"
+#include "VertexLayout.h"
 #include <filesystem>
 #include <map>
+#include <memory>
 
 
 // settings
@@ -20,26 +32,52 @@ const unsigned int SCR_HEIGHT = 720;
 glm::mat4 model = glm::mat4(1.0f);
 glm::mat4 view = glm::mat4(1.0f);
 glm::mat4 projection;
+// picks the level of detail of distant meshes, follows the projection
+LodSelector lodSelector;
+// world space planes of projection * view
+Frustum viewFrustum;
+// the unit cube the cube VAOs draw
+const Bounds cubeBounds(glm::vec3(-0.5f), glm::vec3(0.5f));
+
+// layouts of the vertex arrays in Constants.h
+typedef VertexLayout<Pos2f, Color3f> ColoredPointLayout;
+// a model matrix per instance, one vec4 column per location
+typedef VertexLayout<Attribute<3, 4>, Attribute<4, 4>, Attribute<5, 4>, Attribute<6, 4>> InstanceMatrixLayout;
 
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, 0.0f);
 
 unsigned int loadCubemap(vector<std::string> faces);
 void render_with_border(Model& object, Shader& modelShader, Shader& borderShader, glm::vec3& color);
+bool is_visible(const Bounds& worldBounds);
+void bind_instance_matrices(unsigned int instanceBuffer, size_t firstInstance);
+void render_asteroids(Model& rock, const glm::mat4* modelMatrices, unsigned int amount, unsigned int instanceBuffer);
 
-void render_opaque_objects(vector<glm::vec3>& objects, Shader& alphaShader, unsigned int objectsVAO, unsigned int objectTexture);
+void render_opaque_objects(vector<glm::vec3>& objects, Shader& alphaShader, const Primitives& primitives, const Primitives::Range& quad, unsigned int objectTexture);
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
 unsigned int texturePreparation(std::string img_source, bool rgb, const int GL_TEXTURE_NUM, bool has_alpha = false);
-void setShaderMatrices(Shader& shader, glm::mat4& model, glm::mat4& view, glm::mat4& projection);
+void setModelMatrix(Shader& shader, glm::mat4& model);
+void configureLighting(Shader& shader);
+bool ready_to_draw(Shader& shader, bool& configured, void (*configure)(Shader&));
+ShaderUniforms::Lights sceneLights();
 glm::mat3 computeNormalMat(glm::mat4& model);
+void printFrameStats(float currentFrame);
+#ifdef _DEBUG
+void check_geometry_arena(const std::string& path);
+#endif
 
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 
 glm::mat4 cameraVectors();
 
-int main()
+int main(int argc, char** argv)
 {
+    // --split-streams stores the scene's vertex arrays one stream per attribute instead of interleaved
+    for (int i = 1; i < argc; i++)
+        if (std::string(argv[i]) == "--split-streams")
+            vertexStreams = VertexStreams::Split;
+
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
@@ -73,540 +111,479 @@ int main()
         return -1;
     }
 
-    // configure global opengl state
-    // -----------------------------
-    glEnable(GL_DEPTH_TEST);
-    //glDepthFunc(GL_LEQUAL);
-    glEnable(GL_STENCIL_TEST);
-    //glStencilMask(0x00);
-    //glStencilFunc(GL_EQUAL, 1, 0xFF);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    //glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO);
-    glEnable(GL_CULL_FACE);
-    //glCullFace(GL_FRONT);
-    //glFrontFace(GL_CCW);
-    glEnable(GL_PROGRAM_POINT_SIZE);
-    //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-
-    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
-
-    unsigned int diffuseMap = texturePreparation("container2.png", false, GL_TEXTURE0);
-    unsigned int grassTexture = texturePreparation("blending_transparent_window.png", false, GL_TEXTURE0, true);
-    unsigned int specularMap = texturePreparation("container2_specular.png", false, GL_TEXTURE0);
-    vector<glm::vec3> vegetation
+    // everything owning GL objects lives in here, so it is destroyed while the context still exists
     {
-        glm::vec3(-1.5f, 0.0f, -0.48f),
-        glm::vec3(1.5f, 0.0f, 0.51f),
-        glm::vec3(0.0f, 0.0f, 0.7f),
-        glm::vec3(-0.3f, 0.0f, -2.3f),
-        glm::vec3(0.5f, 0.0f, -0.6f)
-    };
-    //unsigned int texture = texturePreparation("container.jpg", true, GL_TEXTURE0);
-    //unsigned int texture1 = texturePreparation("awesomeface.png", false, GL_TEXTURE1);
-
-    Shader ourShader("./VertexShader.vert", "./FragmentShader.frag");
-    Shader lightCubeShader("./LightSource.vert", "./LightSource.frag");
-    Shader borderShader("./LightSource.vert", "./LightSource.frag");
-    Shader alphaShader("./VertexShader.vert", "./BasicFragmentShader.frag");
-    Shader screenShader("./Framebuffer.vert", "./Postprocess.frag");
-    Shader skyboxShader("./Cubemap.vert", "./Cubemap.frag");
-    Shader reflectionShader("./Reflection.vert", "./Reflection.frag");
-    Shader basicShader("./XY.vert", "./Mono.frag", "./Geomerty.geom");
-    Shader normalShader("./Model.vert", "./Yellow.frag", "./Normals.geom");
-    //Shader instanceShader("./Instancing.vert", "Mono.frag");
-    Shader asteroidsShader("./Instancing.vert", "Asteroids.frag");
-
-
-    Model backpack("./backpack/backpack.obj");
-    Model planet("./planet/planet.obj");
-    Model rock("./rock/rock.obj");
+        // configure global opengl state
+        // -----------------------------
+        glEnable(GL_DEPTH_TEST);
+        //glDepthFunc(GL_LEQUAL);
+        glEnable(GL_STENCIL_TEST);
+        //glStencilMask(0x00);
+        //glStencilFunc(GL_EQUAL, 1, 0xFF);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        //glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO);
+        glEnable(GL_CULL_FACE);
+        //glCullFace(GL_FRONT);
+        //glFrontFace(GL_CCW);
+        glEnable(GL_PROGRAM_POINT_SIZE);
+        //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+
+        glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+
+        // the models are parsed, cooked and their textures decoded on the worker threads while the GL thread
+        // prepares everything else, only the upload below waits for them
+        double modelsStart = glfwGetTime();
+        std::future<StagedModel> backpackStaged = ThreadPool::global().submit([]() { return Model::stage("./backpack/backpack.obj"); });
+        std::future<StagedModel> planetStaged = ThreadPool::global().submit([]() { return Model::stage("./planet/planet.obj"); });
+        std::future<StagedModel> rockStaged = ThreadPool::global().submit([]() { return Model::stage("./rock/rock.obj"); });
+
+        FrameUniforms frameUniforms;
+        // the lights never move, uploaded once
+        UniformBuffer<ShaderUniforms::Lights> lightsBuffer;
+        lightsBuffer.update(sceneLights());
+
+        unsigned int diffuseMap = texturePreparation("container2.png", false, GL_TEXTURE0);
+        unsigned int grassTexture = texturePreparation("blending_transparent_window.png", false, GL_TEXTURE0, true);
+        unsigned int specularMap = texturePreparation("container2_specular.png", false, GL_TEXTURE0);
+        vector<glm::vec3> vegetation
+        {
+            glm::vec3(-1.5f, 0.0f, -0.48f),
+            glm::vec3(1.5f, 0.0f, 0.51f),
+            glm::vec3(0.0f, 0.0f, 0.7f),
+            glm::vec3(-0.3f, 0.0f, -2.3f),
+            glm::vec3(0.5f, 0.0f, -0.6f)
+        };
+        //unsigned int texture = texturePreparation("container.jpg", true, GL_TEXTURE0);
+        //unsigned int texture1 = texturePreparation("awesomeface.png", false, GL_TEXTURE1);
+
+        // shaders are only submitted here, the driver compiles them while the models load
+        double shadersStart = glfwGetTime();
+        Shader::beginBatch();
+        // lighting permutations, the light count is baked in and meshes without a specular map skip it
+        ShaderDefines lightingDefines = { { "NR_POINT_LIGHTS", std::to_string(NR_POINT_LIGHTS) } };
+        ShaderDefines noSpecularDefines = lightingDefines;
+        noSpecularDefines["NO_SPECULAR_MAP"] = "1";
+
+        Shader ourShader(ShaderUniforms::Lighting::reflection, lightingDefines);
+        Shader planetShader(ShaderUniforms::Lighting::reflection, noSpecularDefines);
+        Shader lightCubeShader(ShaderUniforms::LightSource::reflection);
+        Shader borderShader(ShaderUniforms::LightSource::reflection);
+        Shader alphaShader(ShaderUniforms::Alpha::reflection);
+        Shader screenShader(ShaderUniforms::Postprocess::reflection);
+        Shader skyboxShader(ShaderUniforms::Skybox::reflection);
+        Shader reflectionShader(ShaderUniforms::Reflection::reflection);
+        Shader basicShader(ShaderUniforms::Points::reflection);
+        Shader normalShader(ShaderUniforms::Normals::reflection);
+        //Shader instanceShader("./Instancing.vert", "Mono.frag");
+        Shader asteroidsShader(ShaderUniforms::Asteroids::reflection);
+        Shader::endBatch();
+        // cold cache (first run, new driver or edited shaders) compiles everything, warm cache only loads binaries
+        std::cout << "STATS::STARTUP shaders submitted in " << (glfwGetTime() - shadersStart) * 1000.0 << " ms, binary cache hits: "
+            << ProgramBinaryCache::stats.hits << ", misses: " << ProgramBinaryCache::stats.misses
+            << ", shared permutations: " << Shader::sharedPermutations << std::endl;
+
+        // edited shader files are rebuilt in the background and swapped in without restarting
+        ShaderWatcher shaderWatcher;
+        shaderWatcher.watch(Shader::sourceFiles());
+
+
+        Model backpack(backpackStaged.get());
+        Model planet(planetStaged.get());
+        // the rock VAO gets the per-instance matrices below, so it must not be shared with the other models
+        GeometryArena asteroidGeometry;
+        Model rock(rockStaged.get(), false, asteroidGeometry);
+        std::cout << "STATS::STARTUP models loaded in " << (glfwGetTime() - modelsStart) * 1000.0 << " ms on "
+            << ThreadPool::global().size() << " worker threads" << std::endl;
+        TextureCache::Stats textureStats = TextureCache::global().stats();
+        std::cout << "STATS::STARTUP texture cache: " << TextureCache::global().size() << " textures, " << textureStats.residentBytes / 1024
+            << " KB resident, hits: " << textureStats.hits << ", misses: " << textureStats.misses << ", saved " << textureStats.savedBytes / 1024 << " KB" << std::endl;
+        std::cout << "STATS::STARTUP geometry arena: " << GeometryArena::global().poolCount() << " pools, "
+            << GeometryArena::global().usedBytes() / 1024 << " KB used of " << GeometryArena::global().capacityBytes() / 1024 << " KB" << std::endl;
+#ifdef _DEBUG
+        check_geometry_arena("./planet/planet.obj");
+#endif
 
     
-    // Shaders configuration
-    {
-        ourShader.use();
-
-        //unsigned int transformLoc = glGetUniformLocation(ourShader.ID, "transform");
-        ourShader.setVec3("objectColor", 1.0f, 1.0f, 1.0f);
-
-        ourShader.setInt("material.specular", 1);
-        ourShader.setFloat("material.shininess", 64.0f);
-        ourShader.setInt("material.diffuse", 0);
-
-        ourShader.setVec3("dirLight.ambient", 0.2f, 0.2f, 0.2f);
-        ourShader.setVec3("dirLight.diffuse", 0.5f, 1.0f, 0.5f); // darken diffuse light a bit
-        ourShader.setVec3("dirLight.specular", 1.0f, 1.0f, 1.0f);
-        ourShader.setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
-
-        for (int i = 0; i < 4; ++i)
+        // Shaders configuration, done by ready_to_draw on the first frame each program is ready
+        // instead of waiting here for the driver to finish them
+        bool ourShaderConfigured = false, planetShaderConfigured = false, skyboxShaderConfigured = false, reflectionShaderConfigured = false;
+        auto configureSkybox = [](Shader& shader)
         {
-            auto str = "pointLights[" + std::to_string(i) + "].";
-            ourShader.setFloat(str + "constant", 1.0f);
-            ourShader.setFloat(str + "linear", 0.09f);
-            ourShader.setFloat(str + "quadratic", 0.032f);
-
-            ourShader.setVec3(str + "ambient", 0.2f, 0.2f, 0.2f);
-            ourShader.setVec3(str + "diffuse", 1.0f, 0.5f, 0.5f);
-            ourShader.setVec3(str + "specular", 1.0f, 1.0f, 1.0f);
-
-            ourShader.setVec3(str + "position", pointLightPositions[i]);
+            shader.use();
+            shader.set(ShaderUniforms::Skybox::skybox, 0);
+        };
+        auto configureReflection = [](Shader& shader)
+        {
+            shader.use();
+            shader.set(ShaderUniforms::Reflection::skybox, 0);
+        };
+
+        // built-in shapes, all in one buffer and drawn from one VAO
+        Primitives primitives;
+        const Primitives::Range cube = primitives.cube();
+        // the skybox is seen from inside
+        const Primitives::Range skyboxCube = primitives.cube(2.0f, 1, true);
+        // the vegetation quad spans x 0..1 and y -0.5..0.5, its texture is upside down
+        const Primitives::Range vegetationQuad = primitives.quad(glm::vec2(0.0f, -0.5f), glm::vec2(1.0f, 0.5f), glm::vec2(0.0f, 1.0f), glm::vec2(1.0f, 0.0f));
+        const Primitives::Range screenTriangle = primitives.fullscreenTriangle();
+        primitives.upload();
+        std::cout << "STATS::STARTUP primitives: " << primitives.vertexCount() << " vertices, " << primitives.indexCount() << " indices" << std::endl;
+
+        //Square
+        unsigned int squareVAO, squareVBO;
+        {
+            glGenVertexArrays(1, &squareVAO);
+            glBindVertexArray(squareVAO);
+            squareVBO = ColoredPointLayout::createBuffer(points, sizeof(points));
         }
-        skyboxShader.use();
-        skyboxShader.setInt("skybox", 0);
-        reflectionShader.use();
-        reflectionShader.setInt("skybox", 0);
-    }
-
-    short stride = 8 * sizeof(float);
-
-    //Cube
-    unsigned int VBO, EBO, VAO;
-    {
-        //glGenBuffers(1, &EBO);
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-
-        // 1. bind Vertex Array Object
-        glBindVertexArray(VAO);
-        // 2. copy our vertices array in a buffer for OpenGL to use
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), &vertices, GL_STATIC_DRAW);
-        // 3. copy our index array in a element buffer for OpenGL to use
-        //glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        //glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-        // 3. then set our vertex attributes pointers
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
-        glEnableVertexAttribArray(2);
-        //glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
-        //glEnableVertexAttribArray(1);
-        //glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
-        //glEnableVertexAttribArray(2);
-    }
-
-    //Square
-    unsigned int squareVAO, squareVBO;
-    {
-        glGenVertexArrays(1, &squareVAO);
-        glBindVertexArray(squareVAO);
-        
-        glGenBuffers(1, &squareVBO);
-        glBindBuffer(GL_ARRAY_BUFFER, squareVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(points), &points, GL_STATIC_DRAW);
-        
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(2 * sizeof(float)));
-    }
-
-    //LightSource
-    unsigned int lightVAO;
-    {
-        glGenVertexArrays(1, &lightVAO);
-        glBindVertexArray(lightVAO);
-        // we only need to bind to the VBO, the container's VBO's data already contains the data.
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // set the vertex attribute 
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
-    }
-
-    //Reflection
-    unsigned int reflectionVAO;
-    {
-        glGenVertexArrays(1, &reflectionVAO);
-        glBindVertexArray(reflectionVAO);
-        // we only need to bind to the VBO, the container's VBO's data already contains the data.
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // set the vertex attribute 
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
-    }
-    
-    //GrassSource
-    unsigned int vegetationVAO, vegetationVBO;
-    {
-        glGenVertexArrays(1, &vegetationVAO);
-        glGenBuffers(1, &vegetationVBO);
-        glBindVertexArray(vegetationVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, vegetationVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(quad), &quad, GL_STATIC_DRAW);
-        stride = 5 * sizeof(float);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(2);
-    }
-
-    // screen quad VAO
-    unsigned int quadVAO, quadVBO;
-    {
-        glGenVertexArrays(1, &quadVAO);
-        glGenBuffers(1, &quadVBO);
-        glBindVertexArray(quadVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
-    }
-
-    //NEW FRAMEBUFFER SETUP
-    unsigned int textureColorbuffer, framebuffer;
-    {
-        glGenFramebuffers(1, &framebuffer);
-        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
-        // generate texture
-        glGenTextures(1, &textureColorbuffer);
-        glBindTexture(GL_TEXTURE_2D, textureColorbuffer);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        // attach it to currently bound framebuffer object
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureColorbuffer, 0);
-    }
 
-    //FRAMEBUFFER OBJECT
-    unsigned int rbo;
-    {
-        glGenRenderbuffers(1, &rbo);
-        glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT);
-        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        //NEW FRAMEBUFFER SETUP
+        unsigned int textureColorbuffer, framebuffer;
+        {
+            glGenFramebuffers(1, &framebuffer);
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+            // generate texture
+            glGenTextures(1, &textureColorbuffer);
+            glBindTexture(GL_TEXTURE_2D, textureColorbuffer);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            // attach it to currently bound framebuffer object
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureColorbuffer, 0);
+        }
 
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo);
+        //FRAMEBUFFER OBJECT
+        unsigned int rbo;
+        {
+            glGenRenderbuffers(1, &rbo);
+            glBindRenderbuffer(GL_RENDERBUFFER, rbo);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT);
+            glBindRenderbuffer(GL_RENDERBUFFER, 0);
 
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-            std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    }
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo);
 
-    //CUBEMAP
-    vector<std::string> faces =
-    {
-        "skybox/right.jpg",
-        "skybox/left.jpg",
-        "skybox/top.jpg",
-        "skybox/bottom.jpg",
-        "skybox/front.jpg",
-        "skybox/back.jpg"
-    };
-    unsigned int cubemapTexture = loadCubemap(faces);
-    unsigned int skyboxVAO, skyboxVBO;
-    {
-        glGenVertexArrays(1, &skyboxVAO);
-        glGenBuffers(1, &skyboxVBO);
-        glBindVertexArray(skyboxVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    }
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        }
 
-    //Instancing
-    unsigned int instanceVAO, instanceVBO;
-    {
-        glGenVertexArrays(1, &instanceVAO);
-        glGenBuffers(1, &instanceVBO);
-        glBindVertexArray(instanceVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(quadInstanceVertices), &quadInstanceVertices, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(2 * sizeof(float)));
-
-        glm::vec2 translations[100];
+        //CUBEMAP
+        vector<std::string> faces =
+        {
+            "skybox/right.jpg",
+            "skybox/left.jpg",
+            "skybox/top.jpg",
+            "skybox/bottom.jpg",
+            "skybox/front.jpg",
+            "skybox/back.jpg"
+        };
+        unsigned int cubemapTexture = loadCubemap(faces);
+
+        //Instancing
+        unsigned int instanceVAO, instanceVBO;
         {
-            int index = 0;
-            float offset = 0.1f;
-            for (int y = -10; y < 10; y += 2)
+            glGenVertexArrays(1, &instanceVAO);
+            glBindVertexArray(instanceVAO);
+            instanceVBO = ColoredPointLayout::createBuffer(quadInstanceVertices, sizeof(quadInstanceVertices));
+
+            glm::vec2 translations[100];
             {
-                for (int x = -10; x < 10; x += 2)
+                int index = 0;
+                float offset = 0.1f;
+                for (int y = -10; y < 10; y += 2)
                 {
-                    glm::vec2 translation;
-                    translation.x = (float)x / 10.0f + offset;
-                    translation.y = (float)y / 10.0f + offset;
-                    translations[index++] = translation;
+                    for (int x = -10; x < 10; x += 2)
+                    {
+                        glm::vec2 translation;
+                        translation.x = (float)x / 10.0f + offset;
+                        translation.y = (float)y / 10.0f + offset;
+                        translations[index++] = translation;
+                    }
                 }
             }
+            unsigned int instanceOffsetVBO;
+            glGenBuffers(1, &instanceOffsetVBO);
+            glBindBuffer(GL_ARRAY_BUFFER, instanceOffsetVBO);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec2) * 100, &translations[0], GL_STATIC_DRAW);
+            VertexLayout<Attribute<2, 2>>::setAttributes(VertexStreams::Interleaved, 100, 0, 1);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
         }
-        unsigned int instanceOffsetVBO;
-        glGenBuffers(1, &instanceOffsetVBO);
-        glBindBuffer(GL_ARRAY_BUFFER, instanceOffsetVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec2) * 100, &translations[0], GL_STATIC_DRAW);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glEnableVertexAttribArray(2);
-        glBindBuffer(GL_ARRAY_BUFFER, instanceOffsetVBO);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glVertexAttribDivisor(2, 1);
-    }
 
-    //Asteroids
-    unsigned int asteroidsAmount = 1000;
-    glm::mat4* modelMatrices;
-    modelMatrices = new glm::mat4[asteroidsAmount];
-    {
-        srand(glfwGetTime()); // initialize random seed	
-        float radius = 50.0;
-        float offset = 2.5f;
-        for (unsigned int i = 0; i < asteroidsAmount; i++)
+        //Asteroids
+        unsigned int asteroidsAmount = 1000;
+        // refilled every frame with the matrices grouped by level of detail
+        unsigned int asteroidInstanceBuffer;
+        glm::mat4* modelMatrices;
+        modelMatrices = new glm::mat4[asteroidsAmount];
         {
-            glm::mat4 model = glm::mat4(1.0f);
-            // 1. translation: displace along circle with 'radius' in range [-offset, offset]
-            float angle = (float)i / (float)asteroidsAmount * 360.0f;
-            float displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
-            float x = sin(angle) * radius + displacement;
-            displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
-            float y = displacement * 0.4f; // keep height of field smaller compared to width of x and z
-            displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
-            float z = cos(angle) * radius + displacement;
-            model = glm::translate(model, glm::vec3(x, y, z));
-
-            // 2. scale: scale between 0.05 and 0.25f
-            float scale = (rand() % 20) / 100.0f + 0.05;
-            model = glm::scale(model, glm::vec3(scale));
-
-            // 3. rotation: add random rotation around a (semi)randomly picked rotation axis vector
-            float rotAngle = (rand() % 360);
-            model = glm::rotate(model, rotAngle, glm::vec3(0.4f, 0.6f, 0.8f));
-
-            // 4. now add to list of matrices
-            modelMatrices[i] = model;
-        }
+            srand(glfwGetTime()); // initialize random seed	
+            float radius = 50.0;
+            float offset = 2.5f;
+            for (unsigned int i = 0; i < asteroidsAmount; i++)
+            {
+                glm::mat4 model = glm::mat4(1.0f);
+                // 1. translation: displace along circle with 'radius' in range [-offset, offset]
+                float angle = (float)i / (float)asteroidsAmount * 360.0f;
+                float displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
+                float x = sin(angle) * radius + displacement;
+                displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
+                float y = displacement * 0.4f; // keep height of field smaller compared to width of x and z
+                displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
+                float z = cos(angle) * radius + displacement;
+                model = glm::translate(model, glm::vec3(x, y, z));
+
+                // 2. scale: scale between 0.05 and 0.25f
+                float scale = (rand() % 20) / 100.0f + 0.05;
+                model = glm::scale(model, glm::vec3(scale));
+
+                // 3. rotation: add random rotation around a (semi)randomly picked rotation axis vector
+                float rotAngle = (rand() % 360);
+                model = glm::rotate(model, rotAngle, glm::vec3(0.4f, 0.6f, 0.8f));
+
+                // 4. now add to list of matrices
+                modelMatrices[i] = model;
+            }
 
 
-        unsigned int buffer;
-        glGenBuffers(1, &buffer);
-        glBindBuffer(GL_ARRAY_BUFFER, buffer);
-        glBufferData(GL_ARRAY_BUFFER, asteroidsAmount * sizeof(glm::mat4), &modelMatrices[0], GL_STATIC_DRAW);
-        
-        for (unsigned int i = 0; i < rock.meshes.size(); i++)
-        {
-            unsigned int VAO = rock.meshes[i].VAO;
-            glBindVertexArray(VAO);
-            // vertex attributes
-            std::size_t vec4Size = sizeof(glm::vec4);
-            glEnableVertexAttribArray(3);
-            glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 4 * vec4Size, (void*)0);
-            glEnableVertexAttribArray(4);
-            glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, 4 * vec4Size, (void*)(1 * vec4Size));
-            glEnableVertexAttribArray(5);
-            glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, 4 * vec4Size, (void*)(2 * vec4Size));
-            glEnableVertexAttribArray(6);
-            glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, 4 * vec4Size, (void*)(3 * vec4Size));
+            glGenBuffers(1, &asteroidInstanceBuffer);
+            glBindBuffer(GL_ARRAY_BUFFER, asteroidInstanceBuffer);
+            glBufferData(GL_ARRAY_BUFFER, asteroidsAmount * sizeof(glm::mat4), &modelMatrices[0], GL_STREAM_DRAW);
         
-            glVertexAttribDivisor(3, 1);
-            glVertexAttribDivisor(4, 1);
-            glVertexAttribDivisor(5, 1);
-            glVertexAttribDivisor(6, 1);
+            for (unsigned int i = 0; i < rock.meshes.size(); i++)
+            {
+                unsigned int VAO = rock.meshes[i].VAO;
+                glBindVertexArray(VAO);
+                bind_instance_matrices(asteroidInstanceBuffer, 0);
         
-            glBindVertexArray(0);
+                glBindVertexArray(0);
+            }
         }
-    }
     
 
-    //MOUSE HIDE
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+        //MOUSE HIDE
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
-    while (!glfwWindowShouldClose(window))
-    {
-        
+        // setup above bound whatever it needed directly
+        GLState::invalidate();
 
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-        // input
-        processInput(window);
-        ourShader.use();
-        ourShader.setVec3("viewPos", camera.Position);
-        ourShader.setFloat("time", glfwGetTime());
+        bool shadersReported = false;
+        bool texturesReported = false;
+        while (!glfwWindowShouldClose(window))
+        {
+            Shader::reloadChanged(shaderWatcher.changedFiles());
+            Shader::pollPending();
+            if (!shadersReported && Shader::pendingCount() == 0)
+            {
+                shadersReported = true;
+                std::cout << "STATS::STARTUP all shaders ready after " << (glfwGetTime() - shadersStart) * 1000.0 << " ms" << std::endl;
+            }
+            // a few decoded textures per frame replace their placeholders
+            TextureStreamer::global().update();
+            if (!texturesReported && TextureStreamer::global().pendingCount() == 0)
+            {
+                texturesReported = true;
+                std::cout << "STATS::STARTUP all textures resident after " << (glfwGetTime() - modelsStart) * 1000.0 << " ms, "
+                    << TextureStreamer::global().stats().uploaded << " streamed, " << TextureStreamer::global().stats().uploadedBytes / 1024 << " KB" << std::endl;
+            }
+
+            float currentFrame = glfwGetTime();
+            deltaTime = currentFrame - lastFrame;
+            lastFrame = currentFrame;
+            // input
+            processInput(window);
         
-        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
 
-        //RENDERING
-        // rendering commands here
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-        //Disable stencil rewrite for border
-        glStencilMask(0x00);
+            //RENDERING
+            // rendering commands here
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+            //Disable stencil rewrite for border
+            GLState::stencilMask(0x00);
 
-        model = glm::mat4(1.0f);
-        view = camera.GetViewMatrix();
-        projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+            model = glm::mat4(1.0f);
+            view = camera.GetViewMatrix();
+            projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+            lodSelector = LodSelector::fromProjection(projection, (float)SCR_HEIGHT);
+            viewFrustum = Frustum::fromMatrix(projection * view);
+            frameUniforms.update(view, projection, camera.Position, currentFrame);
 
         
 
-        //Rotating cubes
-        {
-            ourShader.use();
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, diffuseMap);
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, specularMap);
-            for (unsigned int i = 0; i < 10; i++)
-            {
-                model = glm::mat4(1.0f);
-                model = glm::translate(model, cubePositions[i]);
-                float angle = 20.0f * i;
-                model = glm::rotate(model, (float)glfwGetTime() * glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-                setShaderMatrices(ourShader, model, view, projection);
-                //ourShader.setVec3("light.position", lightPos);
-                ourShader.setMat3("normalMat", computeNormalMat(model));
+            // programs still compiling are skipped until they are ready
 
-                glBindVertexArray(VAO);
-                glDrawArrays(GL_TRIANGLES, 0, 36);
+            //Rotating cubes
+            if (ready_to_draw(ourShader, ourShaderConfigured, configureLighting))
+            {
+                ourShader.use();
+                GLState::activeTexture(GL_TEXTURE0);
+                GLState::bindTexture(GL_TEXTURE_2D, diffuseMap);
+                GLState::activeTexture(GL_TEXTURE1);
+                GLState::bindTexture(GL_TEXTURE_2D, specularMap);
+                for (unsigned int i = 0; i < 10; i++)
+                {
+                    model = glm::mat4(1.0f);
+                    model = glm::translate(model, cubePositions[i]);
+                    float angle = 20.0f * i;
+                    model = glm::rotate(model, (float)glfwGetTime() * glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+                    if (!is_visible(cubeBounds.transformed(model)))
+                        continue;
+                    setModelMatrix(ourShader, model);
+                    //ourShader.setVec3("light.position", lightPos);
+                    ourShader.set(ShaderUniforms::Lighting::normalMat, computeNormalMat(model));
+
+                    primitives.draw(cube);
+                }
             }
-        }
 
-        //Light cubes render
-        {
-            lightCubeShader.use();
-            lightCubeShader.setVec3("lightColor", 1.0f, 0.5f, 0.5f);
-            for (short i = 0; i < 4; ++i)
+            //Light cubes render
+            if (lightCubeShader.isReady())
             {
-                model = glm::mat4(1.0f);
-                model = glm::translate(model, pointLightPositions[i]);
-                model = glm::scale(model, glm::vec3(0.2f));
-                setShaderMatrices(lightCubeShader, model, view, projection);
-                glBindVertexArray(lightVAO);
-                glDrawArrays(GL_TRIANGLES, 0, 36);
+                lightCubeShader.use();
+                lightCubeShader.set(ShaderUniforms::LightSource::lightColor, glm::vec3(1.0f, 0.5f, 0.5f));
+                for (unsigned int i = 0; i < NR_POINT_LIGHTS; ++i)
+                {
+                    model = glm::mat4(1.0f);
+                    model = glm::translate(model, pointLightPositions[i]);
+                    model = glm::scale(model, glm::vec3(0.2f));
+                    if (!is_visible(cubeBounds.transformed(model)))
+                        continue;
+                    setModelMatrix(lightCubeShader, model);
+                    primitives.draw(cube);
+                }
             }
-        }
 
-        //Reflection cube
-        {
-            reflectionShader.use();
-            reflectionShader.setVec3("cameraPos", camera.Position);
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(1.0, 2.0, 1.0));
-            //reflectionShader.setMat3("normalMat", computeNormalMat(model));
-            setShaderMatrices(reflectionShader, model, view, projection);
-            glBindVertexArray(reflectionVAO);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
-        }
+            //Reflection cube
+            model = glm::translate(glm::mat4(1.0f), glm::vec3(1.0, 2.0, 1.0));
+            if (is_visible(cubeBounds.transformed(model)) && ready_to_draw(reflectionShader, reflectionShaderConfigured, configureReflection))
+            {
+                reflectionShader.use();
+                //reflectionShader.setMat3("normalMat", computeNormalMat(model));
+                setModelMatrix(reflectionShader, model);
+                GLState::activeTexture(GL_TEXTURE0);
+                GLState::bindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+                primitives.draw(cube);
+            }
 
-        //Backpack render
-        {
-            auto borderColor = glm::vec3(1.0, 1.0, 0.0);
-            render_with_border(backpack, ourShader, borderShader, borderColor);
+            //Backpack render
+            if (ready_to_draw(ourShader, ourShaderConfigured, configureLighting) && borderShader.isReady())
+            {
+                auto borderColor = glm::vec3(1.0, 1.0, 0.0);
+                render_with_border(backpack, ourShader, borderShader, borderColor);
             
-            //normalShader.use();
-            //model = glm::translate(glm::mat4(1.0f), glm::vec3(-1.0f, 5.0f, 1.0f));
-            ////normalShader.setMat3("normalMat", computeNormalMat(model));
-            //normalShader.setMat4("projection", projection);
-            //normalShader.setMat4("view", view);
-            //normalShader.setMat4("model", model);
-            //backpack.Draw(normalShader);
-        }
+                //normalShader.use();
+                //model = glm::translate(glm::mat4(1.0f), glm::vec3(-1.0f, 5.0f, 1.0f));
+                ////normalShader.setMat3("normalMat", computeNormalMat(model));
+                //normalShader.setMat4("projection", projection);
+                //normalShader.setMat4("view", view);
+                //normalShader.setMat4("model", model);
+                //backpack.Draw(normalShader);
+            }
 
-        //Skybox
-        {
-            glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
-            skyboxShader.use();
-            auto cubemapView = glm::mat4(glm::mat3(view));
-            setShaderMatrices(skyboxShader, model, cubemapView, projection);
-            glBindVertexArray(skyboxVAO);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
-            glDepthFunc(GL_LESS); // set depth function back to default
-        }
+            //Skybox
+            if (ready_to_draw(skyboxShader, skyboxShaderConfigured, configureSkybox))
+            {
+                GLState::depthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
+                skyboxShader.use();
+                GLState::activeTexture(GL_TEXTURE0);
+                GLState::bindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+                primitives.draw(skyboxCube);
+                GLState::depthFunc(GL_LESS); // set depth function back to default
+            }
 
-        //Opaque objects render (dont forget to sort)
-        render_opaque_objects(vegetation, alphaShader, vegetationVAO, grassTexture);
+            //Opaque objects render (dont forget to sort)
+            if (alphaShader.isReady())
+                render_opaque_objects(vegetation, alphaShader, primitives, vegetationQuad, grassTexture);
 
-        //Geometry shader
-        /*basicShader.use();
-        basicShader.setFloat("time", glfwGetTime());
-        glBindVertexArray(squareVAO);
-        glDrawArrays(GL_POINTS, 0, 4);*/
+            //Geometry shader
+            /*basicShader.use();
+            basicShader.setFloat("time", glfwGetTime());
+            glBindVertexArray(squareVAO);
+            glDrawArrays(GL_POINTS, 0, 4);*/
         
-        //Instancing shader
-        {
-            //instanceShader.use();
-            /*for (unsigned int i = 0; i < 100; i++)
+            //Instancing shader
             {
-                instanceShader.setVec2("offsets[" + std::to_string(i) + "]", translations[i]);
-            }*/
-            //glBindVertexArray(instanceVAO);
-            //glDrawArraysInstanced(GL_TRIANGLES, 0, 6, 100);
-        }
-
-        //Planet and asteroids
-        {
-            ourShader.use();
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(0.0f, -3.0f, 0.0f));
-            model = glm::scale(model, glm::vec3(4.0f, 4.0f, 4.0f));
+                //instanceShader.use();
+                /*for (unsigned int i = 0; i < 100; i++)
+                {
+                    instanceShader.setVec2("offsets[" + std::to_string(i) + "]", translations[i]);
+                }*/
+                //glBindVertexArray(instanceVAO);
+                //glDrawArraysInstanced(GL_TRIANGLES, 0, 6, 100);
+            }
 
-            setShaderMatrices(ourShader, model, view, projection);
+            //Planet and asteroids
+            {
+                model = glm::mat4(1.0f);
+                model = glm::translate(model, glm::vec3(0.0f, -3.0f, 0.0f));
+                model = glm::scale(model, glm::vec3(4.0f, 4.0f, 4.0f));
+                if (is_visible(planet.bounds.transformed(model)) && ready_to_draw(planetShader, planetShaderConfigured, configureLighting))
+                {
+                    planetShader.use();
+                    setModelMatrix(planetShader, model);
 
-            ourShader.setMat3("normalMat", computeNormalMat(model));
-            planet.Draw(ourShader);
+                    planetShader.set(ShaderUniforms::Lighting::normalMat, computeNormalMat(model));
+                    planet.Draw(planetShader, projection * view, model, camera.Position, &lodSelector);
+                }
 
-            // draw meteorites
-            asteroidsShader.use();
+                // draw meteorites
+                if (asteroidsShader.isReady())
+                {
+                    asteroidsShader.use();
 
-            asteroidsShader.setMat4("projection", projection);
-            asteroidsShader.setMat4("view", view);
+                    asteroidsShader.set(ShaderUniforms::Asteroids::texture_diffuse1, 0);
+                    GLState::activeTexture(GL_TEXTURE0);
+                    GLState::bindTexture(GL_TEXTURE_2D, rock.textures_loaded[0].id);
+                    /*model = glm::mat4(1.0f);
+                    model = glm::translate(model, glm::vec3(0.0f, -3.0f, 0.0f));
+                    setModelMatrix(asteroidsShader, model);*/
 
-            asteroidsShader.setInt("texture_diffuse1", 0);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, rock.textures_loaded[0].id);
-            /*model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(0.0f, -3.0f, 0.0f));
-            setShaderMatrices(asteroidsShader, model, view, projection);*/
+                    render_asteroids(rock, modelMatrices, asteroidsAmount, asteroidInstanceBuffer);
+                }
+            }
 
-            for (unsigned int i = 0; i < rock.meshes.size(); i++)
+            // second pass
             {
-                glBindVertexArray(rock.meshes[i].VAO);
-                glDrawElementsInstanced(GL_TRIANGLES, static_cast<unsigned int>(rock.meshes[i].indices.size()), GL_UNSIGNED_INT, 0, asteroidsAmount);
-                glBindVertexArray(0);
-            }
-        }
+                glBindFramebuffer(GL_FRAMEBUFFER, 0); // back to default
+                glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+                glClear(GL_COLOR_BUFFER_BIT);
 
-        // second pass
-        {
-            glBindFramebuffer(GL_FRAMEBUFFER, 0); // back to default
-            glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-            glClear(GL_COLOR_BUFFER_BIT);
+                if (screenShader.isReady())
+                {
+                    screenShader.use();
 
-            screenShader.use();
+                    GLState::disable(GL_DEPTH_TEST);
+                    GLState::activeTexture(GL_TEXTURE0);
+                    GLState::bindTexture(GL_TEXTURE_2D, textureColorbuffer);
+                    primitives.draw(screenTriangle);
 
-            glBindVertexArray(quadVAO);
-            glDisable(GL_DEPTH_TEST);
-            glBindTexture(GL_TEXTURE_2D, textureColorbuffer);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
+                    GLState::enable(GL_DEPTH_TEST);
+                }
+            }
 
-            glEnable(GL_DEPTH_TEST);
-        }
+            printFrameStats(currentFrame);
 
-        // check and call events and swap the buffers
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+            // check and call events and swap the buffers
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
+        glDeleteVertexArrays(1, &squareVAO);
+        glDeleteVertexArrays(1, &instanceVAO);
+        glDeleteBuffers(1, &squareVBO);
+        glDeleteBuffers(1, &instanceVBO);
+        TextureCache::global().release(diffuseMap);
+        TextureCache::global().release(grassTexture);
+        TextureCache::global().release(specularMap);
+
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(1, &rbo);
     }
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteVertexArrays(1, &lightVAO);
-    glDeleteVertexArrays(1, &vegetationVAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &vegetationVBO);
-    glDeleteBuffers(1, &EBO);
-
-    glDeleteFramebuffers(1, &framebuffer);
-    glDeleteFramebuffers(1, &rbo);
+    // the process-wide owners outlive the scope above, they give their objects back explicitly
+    TextureStreamer::global().release();
+    TextureCache::global().clear();
+    GeometryArena::global().release();
 
     glfwTerminate();
 
@@ -648,30 +625,33 @@ unsigned int loadCubemap(vector<std::string> faces)
     return textureID;
 }
 
-void render_opaque_objects(vector<glm::vec3>& objects, Shader& alphaShader, unsigned int objectsVAO, unsigned int objectTexture)
+void render_opaque_objects(vector<glm::vec3>& objects, Shader& alphaShader, const Primitives& primitives, const Primitives::Range& quad, unsigned int objectTexture)
 {
-    glDisable(GL_CULL_FACE);
+    GLState::disable(GL_CULL_FACE);
 
+    // the quad spans x 0..1 and y -0.5..0.5
+    const Bounds quadBounds(glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(1.0f, 0.5f, 0.0f));
     std::map<float, glm::vec3> sorted;
     for (unsigned int i = 0; i < objects.size(); i++)
     {
+        if (!is_visible(quadBounds.transformed(glm::translate(glm::mat4(1.0f), objects[i]))))
+            continue;
         float distance = glm::length(camera.Position - objects[i]);
         sorted[distance] = objects[i];
     }
 
     alphaShader.use();
-    alphaShader.setInt("texture1", 0);
-    glBindVertexArray(objectsVAO);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, objectTexture);
+    alphaShader.set(ShaderUniforms::Alpha::texture1, 0);
+    GLState::activeTexture(GL_TEXTURE0);
+    GLState::bindTexture(GL_TEXTURE_2D, objectTexture);
     for (std::map<float, glm::vec3>::reverse_iterator it = sorted.rbegin(); it != sorted.rend(); ++it)
     {
         model = glm::mat4(1.0f);
         model = glm::translate(model, it->second);
-        setShaderMatrices(alphaShader, model, view, projection);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+        setModelMatrix(alphaShader, model);
+        primitives.draw(quad);
     }
-    glEnable(GL_CULL_FACE);
+    GLState::enable(GL_CULL_FACE);
 }
 
 void render_with_border(Model& object, Shader& modelShader, Shader& borderShader, glm::vec3& color)
@@ -680,32 +660,127 @@ void render_with_border(Model& object, Shader& modelShader, Shader& borderShader
 
     model = glm::translate(glm::mat4(1.0f), glm::vec3(-1.0f, 5.0f, 1.0f));
 
-    setShaderMatrices(modelShader, model, view, projection);
+    // the border is drawn scaled up, visible if either of the two is
+    Bounds drawn = object.bounds.transformed(model);
+    drawn.merge(object.bounds.transformed(glm::scale(model, glm::vec3(1.1f))));
+    if (!is_visible(drawn))
+        return;
+
+    setModelMatrix(modelShader, model);
 
-    modelShader.setMat3("normalMat", computeNormalMat(model));
+    modelShader.set(ShaderUniforms::Lighting::normalMat, computeNormalMat(model));
 
-    glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
-    glStencilFunc(GL_ALWAYS, 1, 0xFF);
-    glStencilMask(0xFF);
+    GLState::stencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+    GLState::stencilFunc(GL_ALWAYS, 1, 0xFF);
+    GLState::stencilMask(0xFF);
 
-    object.Draw(modelShader);
+    object.Draw(modelShader, projection * view, model, camera.Position, &lodSelector);
 
-    glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
-    glStencilMask(0x00); // disable writing to the stencil buffer
+    GLState::stencilFunc(GL_NOTEQUAL, 1, 0xFF);
+    GLState::stencilMask(0x00); // disable writing to the stencil buffer
     //glDisable(GL_DEPTH_TEST);
     borderShader.use();
-    borderShader.setVec3("lightColor", color);
+    borderShader.set(ShaderUniforms::LightSource::lightColor, color);
     model = glm::scale(model, glm::vec3(1.1f));
-    modelShader.setMat4("model", model);
-    setShaderMatrices(borderShader, model, view, projection);
+    setModelMatrix(borderShader, model);
 
-    object.Draw(borderShader);
+    // the border shader reads nothing but the position
+    object.DrawPositions(projection * view, model, camera.Position, &lodSelector);
 
-    glStencilMask(0xFF);
-    glStencilFunc(GL_ALWAYS, 1, 0xFF);
+    GLState::stencilMask(0xFF);
+    GLState::stencilFunc(GL_ALWAYS, 1, 0xFF);
     //glEnable(GL_DEPTH_TEST);
 }
 
+// tests world space bounds against the view frustum and counts the result
+bool is_visible(const Bounds& worldBounds)
+{
+    bool visible = viewFrustum.intersectsBox(worldBounds);
+    if (visible)
+        cullingStats.visible++;
+    else
+        cullingStats.culled++;
+    return visible;
+}
+
+// points the instance matrix attributes (3-6) of the bound VAO at the buffer, starting at firstInstance
+void bind_instance_matrices(unsigned int instanceBuffer, size_t firstInstance)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    InstanceMatrixLayout::setAttributes(VertexStreams::Interleaved, 0, firstInstance * InstanceMatrixLayout::stride, 1);
+}
+
+// draws every rock instance inside the frustum at the level of detail its distance allows. The matrices are uploaded grouped
+// by level and each group is one instanced draw, GL 3.3 has no base instance so the attributes are moved instead
+void render_asteroids(Model& rock, const glm::mat4* modelMatrices, unsigned int amount, unsigned int instanceBuffer)
+{
+    static std::vector<unsigned int> levels;
+    static std::vector<glm::mat4> grouped;
+    static std::vector<glm::vec4> spheres;
+    static std::vector<unsigned char> visible;
+    static std::vector<unsigned int> firstOfLevel;
+    static std::vector<unsigned int> next;
+    levels.resize(amount);
+    grouped.resize(amount);
+    spheres.resize(amount);
+    visible.resize(amount);
+
+    for (Mesh& mesh : rock.meshes)
+    {
+        // world space bounding sphere of every instance, tested against the frustum in one go
+        glm::vec3 center = mesh.bounds.center();
+        float radius = mesh.bounds.radius();
+        for (unsigned int i = 0; i < amount; i++)
+        {
+            float scale = glm::length(glm::vec3(modelMatrices[i][0]));
+            spheres[i] = glm::vec4(glm::vec3(modelMatrices[i] * glm::vec4(center, 1.0f)), radius * scale);
+        }
+        viewFrustum.cullSpheres(spheres.data(), amount, visible.data());
+
+        // the errors are in object space, dividing by the instance scale brings the distance there too
+        firstOfLevel.assign(mesh.lods.size() + 1, 0);
+        for (unsigned int i = 0; i < amount; i++)
+        {
+            if (!visible[i])
+            {
+                cullingStats.culled++;
+                continue;
+            }
+            cullingStats.visible++;
+            float scale = glm::length(glm::vec3(modelMatrices[i][0]));
+            levels[i] = lodSelector.select(mesh.lods, glm::length(camera.Position - glm::vec3(spheres[i])) / scale - radius);
+            firstOfLevel[levels[i] + 1]++;
+        }
+        for (size_t level = 0; level < mesh.lods.size(); level++)
+            firstOfLevel[level + 1] += firstOfLevel[level];
+        unsigned int visibleCount = firstOfLevel.back();
+        if (visibleCount == 0)
+            continue;
+        next.assign(firstOfLevel.begin(), firstOfLevel.end() - 1);
+        for (unsigned int i = 0; i < amount; i++)
+        {
+            if (visible[i])
+                grouped[next[levels[i]]++] = modelMatrices[i];
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, visibleCount * sizeof(glm::mat4), grouped.data());
+
+        GLState::bindVertexArray(mesh.VAO);
+        for (unsigned int level = 0; level < mesh.lods.size(); level++)
+        {
+            unsigned int instances = firstOfLevel[level + 1] - firstOfLevel[level];
+            if (instances == 0)
+                continue;
+            bind_instance_matrices(instanceBuffer, firstOfLevel[level]);
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, mesh.lods[level].indexCount, mesh.indexType,
+                mesh.indexOffset(level), instances, mesh.baseVertex());
+            Mesh::meshletStats.trianglesDrawn += instances * (mesh.lods[level].indexCount / 3);
+            Mesh::meshletStats.trianglesSimplified += instances * ((mesh.lods[0].indexCount - mesh.lods[level].indexCount) / 3);
+        }
+    }
+}
+
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     glViewport(0, 0, width, height);
@@ -732,35 +807,101 @@ void processInput(GLFWwindow* window)
 
 unsigned int texturePreparation(std::string img_source, bool rgb, const int GL_TEXTURE_NUM, bool has_alpha)
 {
-    unsigned int texture;
-    glGenTextures(1, &texture);
-    glActiveTexture(GL_TEXTURE_NUM);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    // set the texture wrapping/filtering options (on the currently bound texture object)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, has_alpha ? GL_CLAMP_TO_EDGE : GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, has_alpha ? GL_CLAMP_TO_EDGE : GL_REPEAT);
-    /*glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);*/
-    // load and generate the texture
-    int width, height, nrChannels;
-    stbi_set_flip_vertically_on_load(!has_alpha);
-    unsigned char* data = stbi_load(img_source.c_str(), &width, &height, &nrChannels, 0);
-    if (data)
+    // the streamer uploads on a unit of its own, callers bind the texture where they sample it
+    (void)GL_TEXTURE_NUM;
+    TextureSettings settings;
+    // set the texture wrapping/filtering options
+    settings.wrap = has_alpha ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+    settings.flipVertically = !has_alpha;
+    settings.internalFormat = has_alpha ? GL_RGBA : GL_RGB;
+    settings.format = rgb ? GL_RGB : GL_RGBA;
+    // see-through until the image is in, so nothing opaque flashes where a window will be
+    static const unsigned char opaquePlaceholder[4] = { 128, 128, 128, 255 };
+    static const unsigned char clearPlaceholder[4] = { 0, 0, 0, 0 };
+    // decoded on the workers and streamed in by TextureStreamer::update
+    return TextureCache::global().acquire(img_source, settings, [&](size_t& bytes) {
+        return TextureStreamer::global().load(img_source, settings, has_alpha ? clearPlaceholder : opaquePlaceholder, bytes);
+    });
+}
+
+// material setup shared by every FragmentShader.frag permutation
+void configureLighting(Shader& shader)
+{
+    shader.use();
+
+    shader.set(ShaderUniforms::Lighting::objectColor, glm::vec3(1.0f, 1.0f, 1.0f));
+
+    shader.set(ShaderUniforms::Lighting::material_specular, 1);
+    shader.set(ShaderUniforms::Lighting::material_shininess, 64.0f);
+    shader.set(ShaderUniforms::Lighting::material_diffuse, 0);
+}
+
+#ifdef _DEBUG
+// frees a model in front of another one, compacts the global arena and allocates the model again. The scene
+// models are drawn every frame from the ranges compact() moved, so a wrong offset shows on screen
+void check_geometry_arena(const std::string& path)
+{
+    GeometryArena& arena = GeometryArena::global();
+    size_t usedBefore = arena.usedBytes();
+    bool valid = true;
     {
-        glTexImage2D(GL_TEXTURE_2D, 0, has_alpha ? GL_RGBA : GL_RGB, width, height, 0, rgb ? GL_RGB : GL_RGBA, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        auto first = std::make_unique<Model>(path);
+        Model second(path);
+        first.reset();
+        arena.compact();
+        valid = valid && arena.usedBytes() == arena.capacityBytes();
+        first = std::make_unique<Model>(path);
     }
-    else
+    arena.compact();
+    valid = valid && arena.usedBytes() == usedBefore && arena.capacityBytes() == usedBefore;
+    if (!valid)
+        std::cout << "ERROR::GEOMETRY_ARENA::CHECK_FAILED used " << arena.usedBytes() << " of " << arena.capacityBytes()
+            << " bytes, expected " << usedBefore << std::endl;
+}
+#endif
+
+// true once shader can draw without waiting for the driver. The first time it is, configure sets the
+// uniforms that never change afterwards
+bool ready_to_draw(Shader& shader, bool& configured, void (*configure)(Shader&))
+{
+    if (configured)
+        return true;
+    if (!shader.isReady())
+        return false;
+    configure(shader);
+    configured = true;
+    return true;
+}
+
+// the light setup read by every FragmentShader.frag permutation through the Lights block
+ShaderUniforms::Lights sceneLights()
+{
+    // the block was reflected with the shader's default light count, the injected one has to match
+    static_assert(NR_POINT_LIGHTS == sizeof(ShaderUniforms::Lights::pointLights) / sizeof(ShaderUniforms::PointLight), "Lights block is out of date");
+    ShaderUniforms::Lights lights = {};
+    lights.dirLight.ambient = glm::vec3(0.2f, 0.2f, 0.2f);
+    lights.dirLight.diffuse = glm::vec3(0.5f, 1.0f, 0.5f); // darken diffuse light a bit
+    lights.dirLight.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+    lights.dirLight.direction = glm::vec3(-0.2f, -1.0f, -0.3f);
+
+    for (unsigned int i = 0; i < NR_POINT_LIGHTS; ++i)
     {
-        std::cout << "Failed to load texture" << std::endl;
+        ShaderUniforms::PointLight& light = lights.pointLights[i];
+        light.constant = 1.0f;
+        light.linear = 0.09f;
+        light.quadratic = 0.032f;
+
+        light.ambient = glm::vec3(0.2f, 0.2f, 0.2f);
+        light.diffuse = glm::vec3(1.0f, 0.5f, 0.5f);
+        light.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+
+        light.position = pointLightPositions[i];
     }
-    stbi_image_free(data);
-    return texture;
+    return lights;
 }
 
-void setShaderMatrices(Shader& ourShader, glm::mat4& model, glm::mat4& view, glm::mat4& projection) {
-    ourShader.setMat4("projection", projection);
-    ourShader.setMat4("view", view);
+// view and projection come from the FrameData block, only the model matrix is per draw
+void setModelMatrix(Shader& ourShader, glm::mat4& model) {
     ourShader.setMat4("model", model);
 }
 
@@ -801,3 +942,28 @@ glm::mat4 cameraVectors() {
 glm::mat3 computeNormalMat(glm::mat4& model) {
     return glm::transpose(glm::inverse(model));
 }
+
+// prints the counters of the frame once per second and resets them for the next one
+void printFrameStats(float currentFrame)
+{
+    static float lastPrint = 0.0f;
+    std::vector<ProgramUniformStats> uniformStats = Shader::takeUniformStats();
+    if (currentFrame - lastPrint >= 1.0f)
+    {
+        lastPrint = currentFrame;
+        std::cout << "STATS::FRAME uniform lookups avoided: " << Shader::stats.lookupsAvoided
+            << ", GL state changes issued: " << GLState::stats.issued << ", skipped: " << GLState::stats.skipped << std::endl;
+        for (const ProgramUniformStats& program : uniformStats)
+            std::cout << "STATS::FRAME " << program.program << " uniforms uploaded: " << program.uploaded
+                << ", unchanged: " << program.skipped << std::endl;
+        const MeshletStats& meshlets = Mesh::meshletStats;
+        std::cout << "STATS::FRAME meshlets drawn: " << meshlets.meshletsDrawn << ", culled: " << meshlets.meshletsCulled
+            << ", triangles culled: " << meshlets.trianglesCulled << " of " << meshlets.trianglesDrawn + meshlets.trianglesCulled
+            << ", left out by LOD: " << meshlets.trianglesSimplified << std::endl;
+        std::cout << "STATS::FRAME objects visible: " << cullingStats.visible << ", culled: " << cullingStats.culled << std::endl;
+    }
+    Shader::stats = ShaderStats();
+    Mesh::meshletStats = MeshletStats();
+    cullingStats = CullingStats();
+    GLState::stats = GLState::Stats();
+}
@@ -0,0 +1,550 @@
+// ShaderReflect: reads the programs listed in Engine/ShaderPrograms.txt, parses their GLSL stages and writes
+// ShaderUniforms.h with a typed Uniform<T> per default block uniform and a std140 mirror of every uniform block.
+// Runs as the pre-build step of Engine, the header is only rewritten when its contents change.
+//
+// usage: ShaderReflect <ShaderPrograms.txt> <ShaderUniforms.h>
+
+#include "../../Engine/ShaderSource.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Field
+    {
+        std::string type;
+        std::string name;
+        // element count, 0 if the field is not an array
+        unsigned int arraySize = 0;
+    };
+
+    struct Block
+    {
+        std::string name;
+        std::vector<Field> members;
+        unsigned int binding = 0;
+    };
+
+    struct Program
+    {
+        std::string name;
+        std::vector<std::string> stages; // vertex, fragment and optional geometry
+        std::vector<Field> uniforms;
+    };
+
+    // everything declared by the parsed stages, structs and blocks are shared by all programs
+    std::map<std::string, std::vector<Field>> structs;
+    std::vector<Block> blocks;
+    bool failed = false;
+
+    void error(const std::string& message)
+    {
+        std::cout << "ERROR::SHADER_REFLECT " << message << std::endl;
+        failed = true;
+    }
+
+    // strips comments and evaluates #define/#ifdef/#ifndef/#else/#endif, other directives are dropped
+    std::string preprocess(const std::string& source, std::map<std::string, std::string>& defines)
+    {
+        std::string code;
+        bool blockComment = false;
+        for (size_t i = 0; i < source.size(); i++)
+        {
+            if (blockComment)
+            {
+                if (source.compare(i, 2, "*/") == 0)
+                {
+                    blockComment = false;
+                    i++;
+                }
+                else if (source[i] == '\n')
+                    code += '\n';
+            }
+            else if (source.compare(i, 2, "/*") == 0)
+            {
+                blockComment = true;
+                i++;
+            }
+            else if (source.compare(i, 2, "//") == 0)
+            {
+                while (i + 1 < source.size() && source[i + 1] != '\n')
+                    i++;
+            }
+            else
+                code += source[i];
+        }
+
+        std::string output;
+        std::vector<bool> active;
+        std::istringstream lines(code);
+        std::string line;
+        while (std::getline(lines, line))
+        {
+            bool enabled = std::find(active.begin(), active.end(), false) == active.end();
+            std::istringstream words(line);
+            std::string directive;
+            words >> directive;
+            if (directive.empty() || directive[0] != '#')
+            {
+                if (enabled)
+                    output += line + '\n';
+                continue;
+            }
+
+            std::string name, value;
+            words >> name;
+            std::getline(words, value);
+            value.erase(0, value.find_first_not_of(" \t"));
+            if (directive == "#ifdef")
+                active.push_back(defines.count(name) != 0);
+            else if (directive == "#ifndef")
+                active.push_back(defines.count(name) == 0);
+            else if (directive == "#if")
+                active.push_back(true); // expressions are not evaluated, declarations behind #if are always seen
+            else if (directive == "#else" && !active.empty())
+                active.back() = !active.back();
+            else if (directive == "#endif" && !active.empty())
+                active.pop_back();
+            else if (directive == "#define" && enabled)
+                defines[name] = value;
+            else if (directive == "#undef" && enabled)
+                defines.erase(name);
+        }
+        return output;
+    }
+
+    std::vector<std::string> tokenize(const std::string& code)
+    {
+        std::vector<std::string> tokens;
+        for (size_t i = 0; i < code.size();)
+        {
+            unsigned char c = code[i];
+            if (std::isspace(c))
+                i++;
+            else if (std::isalnum(c) || c == '_')
+            {
+                size_t start = i;
+                while (i < code.size() && (std::isalnum((unsigned char)code[i]) || code[i] == '_' || code[i] == '.'))
+                    i++;
+                tokens.push_back(code.substr(start, i - start));
+            }
+            else
+                tokens.push_back(std::string(1, code[i++]));
+        }
+        return tokens;
+    }
+
+    unsigned int arraySize(const std::string& token, const std::map<std::string, std::string>& defines)
+    {
+        std::string value = token;
+        for (int depth = 0; depth < 8 && defines.count(value); depth++)
+            value = defines.at(value);
+        try
+        {
+            return static_cast<unsigned int>(std::stoul(value));
+        }
+        catch (...)
+        {
+            error("array size " + token + " is not a constant");
+            return 1;
+        }
+    }
+
+    bool isQualifier(const std::string& token)
+    {
+        return token == "highp" || token == "mediump" || token == "lowp" || token == "flat" || token == "const";
+    }
+
+    // parses "type name[N], name2;" starting at i, returns the index after the ';'
+    size_t parseDeclaration(const std::vector<std::string>& tokens, size_t i, const std::map<std::string, std::string>& defines, std::vector<Field>& fields)
+    {
+        while (i < tokens.size() && isQualifier(tokens[i]))
+            i++;
+        if (i >= tokens.size())
+            return i;
+        std::string type = tokens[i++];
+        while (i < tokens.size() && tokens[i] != ";")
+        {
+            Field field;
+            field.type = type;
+            field.name = tokens[i++];
+            if (i + 2 < tokens.size() && tokens[i] == "[")
+            {
+                field.arraySize = arraySize(tokens[i + 1], defines);
+                i += 3;
+            }
+            fields.push_back(field);
+            if (i < tokens.size() && tokens[i] == ",")
+                i++;
+        }
+        return i + 1;
+    }
+
+    bool sameFields(const std::vector<Field>& a, const std::vector<Field>& b)
+    {
+        if (a.size() != b.size())
+            return false;
+        for (size_t i = 0; i < a.size(); i++)
+            if (a[i].type != b[i].type || a[i].name != b[i].name || a[i].arraySize != b[i].arraySize)
+                return false;
+        return true;
+    }
+
+    void parseStage(const std::string& path, Program& program)
+    {
+        std::vector<std::string> dependencies;
+        std::string source = ShaderSource::load(path, ShaderDefines(), dependencies);
+        if (source.empty())
+        {
+            error("can't read " + path);
+            return;
+        }
+        std::map<std::string, std::string> defines;
+        std::vector<std::string> tokens = tokenize(preprocess(source, defines));
+
+        int depth = 0;
+        for (size_t i = 0; i < tokens.size();)
+        {
+            const std::string& token = tokens[i];
+            if (token == "{" || token == "(")
+            {
+                depth++;
+                i++;
+                continue;
+            }
+            if (token == "}" || token == ")")
+            {
+                depth--;
+                i++;
+                continue;
+            }
+            if (depth != 0)
+            {
+                i++;
+                continue;
+            }
+
+            if (token == "struct" && i + 2 < tokens.size() && tokens[i + 2] == "{")
+            {
+                std::string name = tokens[i + 1];
+                std::vector<Field> fields;
+                i += 3;
+                while (i < tokens.size() && tokens[i] != "}")
+                    i = parseDeclaration(tokens, i, defines, fields);
+                i += 2; // "};"
+                if (structs.count(name) && !sameFields(structs[name], fields))
+                    error("struct " + name + " is declared differently in " + path);
+                structs[name] = fields;
+            }
+            else if (token == "uniform" && i + 2 < tokens.size() && tokens[i + 2] == "{")
+            {
+                Block block;
+                block.name = tokens[i + 1];
+                i += 3;
+                while (i < tokens.size() && tokens[i] != "}")
+                    i = parseDeclaration(tokens, i, defines, block.members);
+                // instance names are not supported, members are accessed unqualified
+                if (i + 1 < tokens.size() && tokens[i + 1] != ";")
+                    error("uniform block " + block.name + " has an instance name");
+                while (i < tokens.size() && tokens[i] != ";")
+                    i++;
+                i++;
+
+                bool known = false;
+                for (const Block& other : blocks)
+                {
+                    if (other.name != block.name)
+                        continue;
+                    known = true;
+                    if (!sameFields(other.members, block.members))
+                        error("uniform block " + block.name + " is declared differently in " + path);
+                }
+                if (!known)
+                {
+                    block.binding = static_cast<unsigned int>(blocks.size());
+                    blocks.push_back(block);
+                }
+            }
+            else if (token == "uniform")
+            {
+                std::vector<Field> fields;
+                i = parseDeclaration(tokens, i + 1, defines, fields);
+                for (const Field& field : fields)
+                {
+                    bool known = false;
+                    for (const Field& other : program.uniforms)
+                        known = known || other.name == field.name;
+                    if (!known)
+                        program.uniforms.push_back(field);
+                }
+            }
+            else
+                i++;
+        }
+    }
+
+    // std140 alignment and size of a type, arrays excluded
+    struct Layout
+    {
+        unsigned int align;
+        unsigned int size;
+        std::string cppType;
+    };
+
+    unsigned int roundUp(unsigned int value, unsigned int multiple)
+    {
+        return (value + multiple - 1) / multiple * multiple;
+    }
+
+    Layout std140Layout(const std::string& type)
+    {
+        static const std::map<std::string, Layout> basic = {
+            { "float", { 4, 4, "float" } },
+            { "int", { 4, 4, "int" } },
+            { "uint", { 4, 4, "unsigned int" } },
+            { "bool", { 4, 4, "int" } }, // GLSL bools are 4 bytes in a block
+            { "vec2", { 8, 8, "glm::vec2" } },
+            { "vec3", { 16, 12, "glm::vec3" } },
+            { "vec4", { 16, 16, "glm::vec4" } },
+            { "ivec2", { 8, 8, "glm::ivec2" } },
+            { "ivec3", { 16, 12, "glm::ivec3" } },
+            { "ivec4", { 16, 16, "glm::ivec4" } },
+            // matrix columns are padded to vec4
+            { "mat2", { 16, 32, "glm::mat2x4" } },
+            { "mat3", { 16, 48, "glm::mat3x4" } },
+            { "mat4", { 16, 64, "glm::mat4" } },
+        };
+        auto it = basic.find(type);
+        if (it != basic.end())
+            return it->second;
+        auto structure = structs.find(type);
+        if (structure == structs.end())
+        {
+            error("type " + type + " can't be used in a uniform block");
+            return { 4, 4, "float" };
+        }
+        unsigned int size = 0;
+        for (const Field& field : structure->second)
+        {
+            Layout member = std140Layout(field.type);
+            unsigned int align = field.arraySize ? roundUp(member.align, 16) : member.align;
+            size = roundUp(size, align) + (field.arraySize ? roundUp(member.size, 16) * field.arraySize : member.size);
+        }
+        return { 16, roundUp(size, 16), type };
+    }
+
+    // writes the members of a std140 struct with explicit padding, followed by checks of every offset
+    void writeStd140Struct(std::ostream& out, const std::string& name, const std::vector<Field>& fields, const std::string& statics)
+    {
+        std::ostringstream members, checks;
+        unsigned int offset = 0;
+        int padding = 0;
+        auto pad = [&](unsigned int to)
+        {
+            if (to > offset)
+                members << "    float _pad" << padding++ << "[" << (to - offset) / 4 << "];\n";
+            offset = to;
+        };
+        for (const Field& field : fields)
+        {
+            Layout layout = std140Layout(field.type);
+            unsigned int align = field.arraySize ? roundUp(layout.align, 16) : layout.align;
+            pad(roundUp(offset, align));
+            checks << "static_assert(offsetof(" << name << ", " << field.name << ") == " << offset << ", \"std140 offset of " << name << "::" << field.name << "\");\n";
+            if (field.arraySize)
+            {
+                unsigned int stride = roundUp(layout.size, 16);
+                std::string element = stride == layout.size ? layout.cppType : "Std140Element<" + layout.cppType + ">";
+                members << "    " << element << " " << field.name << "[" << field.arraySize << "];\n";
+                offset += stride * field.arraySize;
+            }
+            else
+            {
+                members << "    " << layout.cppType << " " << field.name << ";\n";
+                offset += layout.size;
+            }
+        }
+        pad(roundUp(offset, 16));
+
+        out << "struct alignas(16) " << name << "\n{\n" << statics << members.str() << "};\n";
+        out << "static_assert(sizeof(" << name << ") == " << offset << ", \"std140 size of " << name << "\");\n";
+        out << checks.str() << "\n";
+    }
+
+    void writeBlockStructs(std::ostream& out, const std::vector<Field>& fields, std::vector<std::string>& written)
+    {
+        for (const Field& field : fields)
+        {
+            if (!structs.count(field.type) || std::find(written.begin(), written.end(), field.type) != written.end())
+                continue;
+            writeBlockStructs(out, structs[field.type], written);
+            written.push_back(field.type);
+            writeStd140Struct(out, field.type, structs[field.type], "");
+        }
+    }
+
+    // C++ type a default block uniform is set with, empty if Shader has no setter for it
+    std::string uniformType(const std::string& type)
+    {
+        static const std::map<std::string, std::string> types = {
+            { "float", "float" }, { "int", "int" }, { "bool", "bool" },
+            { "vec2", "glm::vec2" }, { "vec3", "glm::vec3" },
+            { "mat3", "glm::mat3" }, { "mat4", "glm::mat4" },
+        };
+        if (type.compare(0, 7, "sampler") == 0)
+            return "int"; // texture unit
+        auto it = types.find(type);
+        return it == types.end() ? "" : it->second;
+    }
+
+    // flattens structs and arrays into the names glGetUniformLocation takes
+    void flattenUniform(const std::string& type, const std::string& name, unsigned int arraySize, std::vector<std::pair<std::string, std::string>>& leaves)
+    {
+        if (arraySize)
+        {
+            for (unsigned int i = 0; i < arraySize; i++)
+                flattenUniform(type, name + "[" + std::to_string(i) + "]", 0, leaves);
+            return;
+        }
+        auto structure = structs.find(type);
+        if (structure != structs.end())
+        {
+            for (const Field& field : structure->second)
+                flattenUniform(field.type, name + "." + field.name, field.arraySize, leaves);
+            return;
+        }
+        std::string cppType = uniformType(type);
+        if (cppType.empty())
+            std::cout << "WARNING::SHADER_REFLECT no setter for " << type << " " << name << ", skipped" << std::endl;
+        else
+            leaves.push_back({ name, cppType });
+    }
+
+    std::string identifier(const std::string& name)
+    {
+        std::string id;
+        for (char c : name)
+        {
+            if (c == '.' || c == '[')
+                id += '_';
+            else if (c != ']')
+                id += c;
+        }
+        return id;
+    }
+
+    std::string generate(const std::vector<Program>& programs)
+    {
+        std::ostringstream out;
+        out << "// generated by ShaderReflect from ShaderPrograms.txt, do not edit\n"
+            << "#pragma once\n\n"
+            << "#include <cstddef>\n\n"
+            << "#include <glm/glm/glm.hpp>\n\n"
+            << "#include \"Shader.h\"\n\n"
+            << "namespace ShaderUniforms\n{\n"
+            << "// scalar or vector array element, std140 pads each one to 16 bytes\n"
+            << "template <typename T>\n"
+            << "struct alignas(16) Std140Element\n{\n    T value;\n};\n\n";
+
+        out << "// uniform blocks, the same in every program declaring them\n";
+        std::vector<std::string> written;
+        for (const Block& block : blocks)
+        {
+            writeBlockStructs(out, block.members, written);
+            std::string statics = "    static constexpr const char* blockName = \"" + block.name + "\";\n"
+                "    static constexpr unsigned int binding = " + std::to_string(block.binding) + ";\n\n";
+            writeStd140Struct(out, block.name, block.members, statics);
+        }
+        out << "inline constexpr UniformBlockBinding uniformBlocks[] = {\n";
+        for (const Block& block : blocks)
+            out << "    { \"" << block.name << "\", " << block.binding << " },\n";
+        out << "};\n\n";
+
+        for (const Program& program : programs)
+        {
+            std::vector<std::pair<std::string, std::string>> leaves;
+            for (const Field& field : program.uniforms)
+                flattenUniform(field.type, field.name, field.arraySize, leaves);
+
+            out << "namespace " << program.name << "\n{\n";
+            if (!leaves.empty())
+            {
+                out << "    inline constexpr const char* uniformNames[] = {\n";
+                for (const auto& leaf : leaves)
+                    out << "        \"" << leaf.first << "\",\n";
+                out << "    };\n";
+            }
+            out << "    inline constexpr ProgramReflection reflection = { \"" << program.name << "\", ";
+            for (size_t i = 0; i < 3; i++)
+                out << (i < program.stages.size() ? "\"./" + program.stages[i] + "\"" : std::string("nullptr")) << ", ";
+            out << (leaves.empty() ? "nullptr" : "uniformNames") << ", " << leaves.size() << " };\n";
+            if (!leaves.empty())
+                out << "\n";
+            for (size_t i = 0; i < leaves.size(); i++)
+                out << "    inline constexpr Uniform<" << leaves[i].second << "> " << identifier(leaves[i].first) << " = { &reflection, " << i << " };\n";
+            out << "}\n\n";
+        }
+        out << "}\n";
+        return out.str();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3)
+    {
+        std::cout << "usage: ShaderReflect <ShaderPrograms.txt> <ShaderUniforms.h>" << std::endl;
+        return 1;
+    }
+    std::filesystem::path manifestPath = argv[1];
+    std::ifstream manifest(manifestPath);
+    if (!manifest)
+    {
+        error("can't read " + manifestPath.string());
+        return 1;
+    }
+
+    // one program per line: name, vertex, fragment and optional geometry stage, relative to the list
+    std::vector<Program> programs;
+    std::string line;
+    while (std::getline(manifest, line))
+    {
+        std::istringstream words(line);
+        Program program;
+        if (!(words >> program.name) || program.name[0] == '#')
+            continue;
+        std::string stage;
+        while (words >> stage)
+            program.stages.push_back(stage);
+        if (program.stages.size() < 2 || program.stages.size() > 3)
+        {
+            error("program " + program.name + " needs a vertex, a fragment and an optional geometry stage");
+            continue;
+        }
+        for (const std::string& path : program.stages)
+            parseStage((manifestPath.parent_path() / path).generic_string(), program);
+        programs.push_back(program);
+    }
+    if (failed)
+        return 1;
+
+    // rewriting an unchanged header would rebuild everything including it
+    std::string header = generate(programs);
+    std::ifstream previous(argv[2], std::ios::binary);
+    std::stringstream previousHeader;
+    previousHeader << previous.rdbuf();
+    if (previous && previousHeader.str() == header)
+        return 0;
+    previous.close();
+    std::ofstream output(argv[2], std::ios::binary);
+    output << header;
+    return failed || !output ? 1 : 0;
+}